@@ -0,0 +1,44 @@
+//*****************************************************************************
+//
+// File Name	: 'library.h'
+// Title		: SPI NOR flash waveform library format (LIBRARY build), shared by main.c and wavelib.c
+// Target		: Atmel AVR series and the host
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#ifndef LIBRARY_H
+#define LIBRARY_H
+
+#include <stdint.h>
+
+/*SPI NOR flash waveform library, the image is built by wavelib.c:
+	0                header: "DDSLIB1" and a zero, uint16_t entries, 6 bytes reserved
+	LIB_ENTRIES      struct LibraryEntry for each entry
+	entry.address    LIB_SAMPLES samples
+All the values are little endian. An entry is a preset: the samples and the frequency (0 keeps config.freq).
+*/
+#define LIB_MAGIC      "DDSLIB1"
+#define LIB_ENTRIES    16        // address of the directory, after the header
+#define LIB_SAMPLES    256       // samples of an entry, SIGNAL_BUFFER_SIZE of main.c
+
+struct LibraryHeader {
+	char     magic[8];
+	uint16_t count;
+	uint8_t  reserved[6];
+};
+
+struct LibraryEntry {
+	char     name[14];           // 13 characters of the LCD and a zero
+	uint16_t reserved;
+	float    freq;               // Hz, 0 - keep the current frequency
+	uint32_t address;            // of the samples
+	uint8_t  reserved2[8];
+};
+
+// avr-gcc and the host compiler must agree on the layout: no padding, float is the IEEE single
+_Static_assert(sizeof(struct LibraryHeader) == LIB_ENTRIES, "struct LibraryHeader must be 16 bytes");
+_Static_assert(sizeof(struct LibraryEntry) == 32, "struct LibraryEntry must be 32 bytes");
+
+#endif
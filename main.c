@@ -13,8 +13,12 @@
 //
 //*****************************************************************************
 #include <stdio.h>
+#include <stdarg.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+#include <math.h>
 #include <avr/io.h>
 #include <avr/pgmspace.h>
 #include <avr/eeprom.h>
@@ -22,6 +26,8 @@
 #include <util/delay.h>
 #include <inttypes.h>
 #include "lcd_lib.h"
+#include "waves.h"       // generated by wavegen, see the Makefile
+#include "library.h"
 
 // define R2R port
 #define R2RPORT PORTA
@@ -47,18 +53,101 @@
 #define HSPIN   PIND
 #define HS      5
 
+// define the stop flag of the DDS loops: set by the interrupts, polled by sbis/sbic in the asm loops;
+// TWBR is a plain register of the bit-addressable I/O space and the TWI is never enabled
+#define STOP_REG TWBR
+#define STOP_BIT 2
+
+// define counter inputs: T1 (PB1) for the frequency, AIN1 (PB3) for the period and the pulse width
+#define CNTDDR  DDRB
+#define CNTPORT PORTB
+#define CNT_T1  1
+#define CNT_AIN 3
+
+// define optional modes: 1 in the Makefile; the ATmega16 holds the base generator and one of RECORD_PLAYBACK
+// (with a short record), PHASE_CONTROL or LIBRARY, the others need the pin compatible ATmega32
+// (MCU = atmega32), see the sizes in README.md
+#ifndef TIMER1_MODES
+#define TIMER1_MODES 0      // Pulse Train, HS Clock and its bursts, ICR1 PWM, dual output
+#endif
+#ifndef COUNTER
+#define COUNTER 0           // Counter and Auto Calibrate
+#endif
+#ifndef MODULATION
+#define MODULATION 0        // phase and toggle sync, FSK, PSK, Dual Tone
+#endif
+#ifndef SYNTH
+#define SYNTH 0             // Shape and Harmonics
+#endif
+#ifndef TRIGGER_MODES
+#define TRIGGER_MODES 0     // Trigger Edge, Holdoff, Burst, Burst Rearm, gate sync
+#endif
+#ifndef PHASE_CONTROL
+#define PHASE_CONTROL 0     // Start Phase, Stop at the end of the period, Analog PWM Duty
+#endif
+#ifndef RECORD_PLAYBACK
+#define RECORD_PLAYBACK 0   // Record, the records of waves.h
+#endif
+
+// define USART remote control: REMOTE = 1 in the Makefile; RXD and TXD are PD0 and PD1,
+// so the DOWN and LEFT buttons are not available, the remote commands replace them
+#ifndef REMOTE
+#define REMOTE 0
+#endif
+#define REMOTE_BAUD    115200    // U2X, +2.1%
+#define REMOTE_RX_SIZE 64        // receive ring buffer, power of 2
+#define REMOTE_LINE    48        // longest text command or binary frame
+#define REMOTE_SYNC    0xA5      // starts a binary frame, never in the text commands
+#define REMOTE_ARB_SYNC 0xA6     // starts an ARB upload: SIGNAL_BUFFER_SIZE samples and the checksum
+#define STREAM_PREFILL 96        // streamed samples buffered before the output starts
+#define STREAM_XOFF    160       // the host is paused (XOFF) at this many buffered samples, the rest of
+#define STREAM_XON     128       // the ring takes what is in flight; resumed (XON) below STREAM_XON
+#define XON            0x11
+#define XOFF           0x13
+
+// define SPI NOR flash waveform library: LIBRARY = 1 in the Makefile; any 25-series flash (read command 0x03,
+// 24-bit address) on the SPI pins, CS on PB4 (SS); the ISP pins, the flash must keep CS high while programming
+#ifndef LIBRARY
+#define LIBRARY 0
+#endif
+#define LIB_DDR        DDRB
+#define LIB_PORT       PORTB
+#define LIB_CS         4
+#define LIB_MOSI       5
+#define LIB_MISO       6
+#define LIB_SCK        7
+
 // define eeprom addresses
 #define EE_CONFIG     0
 #define EE_INIT       E2END
+#define EE_INIT_MARK  ((uint8_t)('T' + sizeof(struct Config))) // changes with the config layout
+#define EE_ARB(slot)  (EE_INIT - ((slot) + 1) * SIGNAL_BUFFER_SIZE)       // ARB slots, down from EE_INIT
+#define ARB_SLOTS     ((EE_INIT - sizeof(struct Config)) / SIGNAL_BUFFER_SIZE) // 1 on ATmega16
 
 #define CPU_FREQ            16000000ul
 #define OUT_TICKS           10
 #define OUT_SYNC_TICKS      15
+#define PHASE_SYNC_TICKS    14
+#define TOGGLE_SYNC_TICKS   13
+#define FSK_OUT_TICKS       13
+#define PSK_OUT_TICKS       13
+#define DUAL_TONE_TICKS     15
+#define RECORD_TICKS        15
+#define BURST_OUT_TICKS     13
+#define GATE_OUT_TICKS      12
+#define PWM_COMPARE_TICKS   11
 #define SWEEP_OUT_TICKS     9
 #define ACC_FRAC_BITS       24
 #define SWEEP_ACC_FRAC_BITS 16
 #define SIGNAL_BUFFER_SIZE  256
 
+#if WAVE_SIZE != SIGNAL_BUFFER_SIZE || WAVE_BITS != 8
+#error "waves.h must be generated for SIGNAL_BUFFER_SIZE samples of the 8-bit R2R DAC"
+#endif
+#if LIB_SAMPLES != SIGNAL_BUFFER_SIZE
+#error "library.h entries must have SIGNAL_BUFFER_SIZE samples"
+#endif
+
 #define MIN_FREQ      0.0        // minimum DDS frequency
 #define MAX_FREQ      250000.0   // maximum DDS frequency
 #define MIN_FREQ_STEP 0.001      // minimum DDS frequency step
@@ -71,20 +160,77 @@
 #define MIN_PULSE     0.001      // minimum pulse duration, ms
 #define MAX_PULSE     1000.0     // maximum pulse duration, ms
 
+// trigger edge to first sample, see triggeredSignalOut(): 16 cycles after the sampling
+// instruction, the polling period adds 0..4 cycles, the input synchronizer about 1 more
+#define TRIGGER_TICKS 19
+
+#define NO_TRIGGER    0x80       // burstOut() and pulseOut() start without the trigger
+
+// pulseOut(): both delays are 5 * n + r cycles (n > 0, r < 5) plus the fixed part;
+// the HS edge is 5 * n + r + 8 cycles after the sampling of the trigger + polling (0..4) + synchronizer (~1)
+#define PULSE_MIN_TICKS     9
+#define PULSE_TRIGGER_TICKS 11
+#define MAX_BURST     65535      // maximum number of periods in a burst
+#define HS_BURST_ISR_TICKS 256   // HS clock bursts with longer half-periods are stopped by TIMER1_COMPA_vect
+#define MAX_COUNTER_GATE 10000   // maximum gate time of the counter, ms
+#define HARMONICS     16         // harmonics of the additive synthesis
+#define MAX_HARM_AMP  1000       // harmonic amplitude, 0.1% units
+#define MAX_RECORD_RATE 1000000.0 // maximum sample rate of the record playback, Hz
+
+#define MIN_TRAIN_PERIOD 0.005   // minimum pulse train period, ms
+#define MAX_TRAIN_PERIOD 4000.0  // maximum pulse train period (Timer1 with prescaler 1024), ms
+#define MIN_HS_CLOCK  0.12       // minimum HS clock: 16 MHz / 2 / 1024 / 65536, Hz
+#define MAX_HS_CLOCK  8000000.0  // maximum HS clock, Hz
+#define MIN_PWM_FREQ  0.25       // minimum ICR1 PWM frequency, Hz
+#define MAX_PWM_FREQ  4000000.0  // maximum ICR1 PWM frequency (TOP = 3), Hz
+#define MIN_STREAM_RATE 245      // Timer1 CTC without the prescaler, Hz
+#define MAX_STREAM_RATE 11025    // 115200 baud carries 11520 bytes/s, Hz
+
 void timer2Init(void);
 void timer2Start(void);
 void timer2Stop(void);
 void timer1Start(uint8_t);
+void timer1StartCtc(uint8_t, uint16_t);
+uint8_t timer1SetupCtc(uint8_t, uint16_t);
+uint8_t timer1FindCtc(double, uint16_t *);
+double timer1CtcFreq(uint8_t, uint16_t);
+uint8_t timer1FindPwm(double, bool, uint16_t *);
+double timer1PwmFreq(uint8_t, uint16_t, bool);
+void timer1StartPwmIcr(uint8_t, uint16_t, uint16_t, bool);
+uint8_t timer1SetupPwmIcr(uint8_t, uint16_t, uint16_t, bool);
+uint8_t dual_prepareTimer(void);
+void hsBurst_run(uint8_t, uint16_t);
 void timer1StartPwm(uint16_t);
 void timer1Stop(void);
-inline void static signalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t);
+uint8_t timer1Prescaler(uint32_t, uint16_t *);
+void timer1StartPulseTrain(uint8_t, uint16_t, uint16_t, uint16_t);
+inline uint32_t static signalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static finishOut(const uint8_t *, uint32_t, uint8_t, uint8_t, uint8_t, uint8_t);
 inline void static signalWithSyncOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static signalWithPhaseSync(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static signalWithToggleSync(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static fskSignalOut(const uint8_t *, uint32_t, uint32_t);
+inline void static pskSignalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static dualToneOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static recordOut(const uint8_t **, uint32_t *, uint32_t, const uint8_t *, uint16_t, bool);
+inline void static lockedSignalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
 inline void static randomSignalOut(const uint8_t *);
 inline void static sweepOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static triggerWait(uint8_t, uint32_t);
+inline void static triggeredSignalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint32_t);
+inline void static burstOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint16_t, uint8_t, uint32_t);
+inline void static gatedSignalOut(const uint8_t *, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, bool);
+inline void static pwmCompareOut(uint8_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static mirrorHsOut(uint8_t, uint8_t);
+inline void static pulseOut(uint8_t, uint32_t, uint8_t, uint32_t, uint8_t, uint8_t, uint8_t, uint8_t, uint8_t);
+inline void static hsBurstOut(bool, uint32_t, uint8_t, uint8_t, uint8_t);
 
 // button processing
 typedef void (ButtonHandlerFn_t)(void);
 void processButton(void);
+#if REMOTE
+void remote_process(void);
+#endif
 void buttonNop(void);
 void menu_onUp(void);
 void menu_onDown(void);
@@ -106,6 +252,9 @@ void pulse_onRight(void);
 void hs_onLeft(void);
 void hs_onRight(void);
 void hs_onStart(void);
+void hsClock_onLeft(void);
+void hsClock_onRight(void);
+void hsClock_onStart(void);
 void pwm_onUp(void);
 void pwm_onDown(void);
 void pwm_onLeft(void);
@@ -116,11 +265,82 @@ void pwmHs_onDown(void);
 void pwmHs_onLeft(void);
 void pwmHs_onRight(void);
 void pwmHs_onStart(void);
+void pwmHr_onUp(void);
+void pwmHr_onDown(void);
+void pwmHr_onLeft(void);
+void pwmHr_onRight(void);
+void pwmHr_onStart(void);
+void pwmMode_onLeft(void);
+void pwmMode_onRight(void);
+void pwmFine_onLeft(void);
+void pwmFine_onRight(void);
+void hsLock_onLeft(void);
+void hsLock_onRight(void);
+void hsBurst_onLeft(void);
+void hsBurst_onRight(void);
+void counter_onLeft(void);
+void counter_onRight(void);
+void counter_onStart(void);
+void counterGate_onLeft(void);
+void counterGate_onRight(void);
+void counterAvg_onLeft(void);
+void counterAvg_onRight(void);
+void syncPhase_onLeft(void);
+void syncPhase_onRight(void);
+void syncDuty_onLeft(void);
+void syncDuty_onRight(void);
+void startPhase_onLeft(void);
+void startPhase_onRight(void);
+void stopMode_onLeft(void);
+void stopMode_onRight(void);
+void fskFreq_onLeft(void);
+void fskFreq_onRight(void);
+void pskPhase_onLeft(void);
+void pskPhase_onRight(void);
 void sweep_onUp(void);
 void sweep_onDown(void);
 void sweep_onLeft(void);
 void sweep_onRight(void);
 void sweep_onStart(void);
+void train_onUp(void);
+void train_onDown(void);
+void train_onLeft(void);
+void train_onRight(void);
+void train_onStart(void);
+void shapeType_onLeft(void);
+void shapeType_onRight(void);
+void shapeSymmetry_onLeft(void);
+void shapeSymmetry_onRight(void);
+void shapeDuty_onLeft(void);
+void shapeDuty_onRight(void);
+void harmonics_onStart(void);
+#if REMOTE
+void arb_onStart(void);
+void stream_onLeft(void);
+void stream_onRight(void);
+void stream_onStart(void);
+#endif
+void harmonic_onLeft(void);
+void harmonic_onRight(void);
+void harmAmp_onLeft(void);
+void harmAmp_onRight(void);
+void harmPhase_onLeft(void);
+void harmPhase_onRight(void);
+void dualTone_onUp(void);
+void dualTone_onDown(void);
+void dualTone_onLeft(void);
+void dualTone_onRight(void);
+void dualTone_onStart(void);
+void record_onUp(void);
+void record_onDown(void);
+void record_onLeft(void);
+void record_onRight(void);
+void record_onStart(void);
+#if LIBRARY
+void library_onLeft(void);
+void library_onRight(void);
+void library_onStart(void);
+#endif
 void offLevel_onLeft(void);
 void offLevel_onRight(void);
 void syncOut_onLeft(void);
@@ -128,30 +348,84 @@ void syncOut_onRight(void);
 void syncOut_onOpt(void);
 void trigger_onLeft(void);
 void trigger_onRight(void);
+void triggerEdge_onLeft(void);
+void triggerEdge_onRight(void);
+void holdoff_onLeft(void);
+void holdoff_onRight(void);
+void burst_onLeft(void);
+void burst_onRight(void);
+void burstRearm_onLeft(void);
+void burstRearm_onRight(void);
+void gateHold_onLeft(void);
+void gateHold_onRight(void);
 void calFreq_onLeft(void);
 void calFreq_onRight(void);
 void calFreq_onStart(void);
+void autoCal_onLeft(void);
+void autoCal_onRight(void);
+void autoCal_onStart(void);
 
 // menu processing
 typedef void (MenuItemEnterHandlerFn_t)(void);
 void signal_updateDisplay(void);
+void shape_updateDisplay(void);
+void shapeType_updateDisplay(void);
+void shapeSymmetry_updateDisplay(void);
+void shapeDuty_updateDisplay(void);
+void harmonic_updateDisplay(void);
+void harmAmp_updateDisplay(void);
+void harmPhase_updateDisplay(void);
+#if REMOTE
+void stream_updateDisplay(void);
+#endif
 void noise_updateDisplay(void);
 void pulse_updateDisplay(void);
 void freqStep_updateDisplay(void);
 void freqMode_updateDisplay(void);
 void hs_updateDisplay(void);
+void hsClock_updateDisplay(void);
 void pwm_updateDisplay(void);
 void pwmHs_updateDisplay(void);
+void pwmHr_updateDisplay(void);
+void pwmMode_updateDisplay(void);
+void pwmFine_updateDisplay(void);
+void hsLock_updateDisplay(void);
+void hsBurst_updateDisplay(void);
+void counter_updateDisplay(void);
+void counterGate_updateDisplay(void);
+void counterAvg_updateDisplay(void);
+void syncPhase_updateDisplay(void);
+void syncDuty_updateDisplay(void);
+void startPhase_updateDisplay(void);
+void stopMode_updateDisplay(void);
+void fskFreq_updateDisplay(void);
+void pskPhase_updateDisplay(void);
 void sweep_updateDisplay(void);
+void train_updateDisplay(void);
+void dualTone_updateDisplay(void);
+void record_updateDisplay(void);
+#if LIBRARY
+void library_updateDisplay(void);
+#endif
 void offLevel_updateDisplay(void);
 void syncOut_updateDisplay(void);
 void trigger_updateDisplay(void);
+void triggerEdge_updateDisplay(void);
+void holdoff_updateDisplay(void);
+void burst_updateDisplay(void);
+void burstRearm_updateDisplay(void);
+void gateHold_updateDisplay(void);
 void calFreq_updateDisplay(void);
+void autoCal_updateDisplay(void);
 
 // adjust LCDsendChar() function for strema
 static int LCDsendstream(char c, FILE *stream);
 // set output stream to LCD
 static FILE lcd_str = FDEV_SETUP_STREAM(LCDsendstream, NULL, _FDEV_SETUP_WRITE);
+// print_P() of the formats used here, see vprint_P()
+void vprint_P(FILE *stream, const char *format, va_list ap);
+void print_P(const char *format, ...);
+void fprint_P(FILE *stream, const char *format, ...);
 
 struct ButtonHandlers {
 	ButtonHandlerFn_t * onUp;
@@ -169,19 +443,50 @@ struct MenuEntry {
 	struct ButtonHandlers buttonHandlers;
 };
 
+// the values are the same in all builds (they are stored in the EEPROM and set by the remote),
+// isSyncOutAvailable() tells the ones of the build options
 enum SyncOut {
-	SyncOut_Off,
-	SyncOut_Single,
-	SyncOut_Multiple,
-	SyncOut_Trigger,
+	SyncOut_Off      = 0,
+	SyncOut_Single   = 1,
+	SyncOut_Multiple = 2,
+	SyncOut_Trigger  = 3,
+	SyncOut_Gate     = 4,   // TRIGGER_MODES
+	SyncOut_Clock    = 5,   // TIMER1_MODES: Timer1 clock (HS Clock) on HS together with the DDS
+	SyncOut_Pwm      = 6,   // TIMER1_MODES: Timer1 PWM (ICR1 PWM) on HS together with the DDS
+	SyncOut_Phase    = 7,   // MODULATION: high from the sync phase for the sync duty of each period
+	SyncOut_Toggle   = 8,   // MODULATION: toggled at the sync phase of each period
+	SyncOut_Fsk      = 9,   // MODULATION: HS input selects the frequency: low - freq, high - fskFreq
+	SyncOut_Psk      = 10,  // MODULATION: HS input selects the phase: low - 0, high - pskPhase
 	SyncOut_End
 };
 
+enum TriggerEdge {
+	TriggerEdge_High,      // high level on the HS input
+	TriggerEdge_Rising,
+	TriggerEdge_Falling,
+	TriggerEdge_Both,
+	TriggerEdge_End
+};
+
 enum FreqMode {
 	FreqMode_Exact,
 	FreqMode_Jitter
 };
 
+enum ShapeType {
+	ShapeType_Sine,
+	ShapeType_Triangle,
+	ShapeType_Pulse,
+	ShapeType_End
+};
+
+enum CounterMode {
+	CounterMode_Freq,      // edges on T1 during the gate time
+	CounterMode_Period,    // rising to rising edge on AIN1
+	CounterMode_Width,     // rising to falling edge on AIN1
+	CounterMode_End
+};
+
 struct Config {
 	uint8_t       menuEntry;     // active or last active main menu entry
 	double        freq;          // frequency value, Hz
@@ -197,6 +502,46 @@ struct Config {
 	double        pulse;         // pulse duration, ms
 	enum SyncOut  syncOut;
 	double        triggerDelay;  // deleay after trigger detection, ms
+	enum TriggerEdge triggerEdge;
+	double        triggerHoldoff; // time before the trigger is armed again, ms
+	uint16_t      burst;         // periods per start or trigger, 0 - continuous
+	bool          burstRearm;    // re-arm the trigger after each burst
+	bool          gateHold;      // hold the phase and the output while the gate is low, otherwise output offLevel
+	double        trainPeriod;   // pulse train period, ms
+	double        trainWidth;    // pulse train pulse width, ms
+	uint16_t      trainCount;    // pulses in the train, 0 - infinite
+	double        trainDelay;    // delay before the first pulse, ms
+	double        hsClock;       // arbitrary HS clock, Hz
+	double        pwmHrFreq;     // ICR1 PWM frequency, Hz
+	double        pwmHrDuty;     // ICR1 PWM duty [0..1]
+	bool          pwmPhaseCorrect; // ICR1 PWM mode: phase correct or fast
+	bool          pwmFine;       // analog PWM by the phase compare instead of the table
+	uint16_t      pwmFineDuty;   // analog PWM duty in the compare mode [0..65535]/65536
+	bool          hsLock;        // dual output: restart Timer1 and DDS together
+	uint16_t      hsBurst;       // HS clock cycles per start, 0 - continuous
+	enum CounterMode counterMode;
+	uint16_t      counterGate;   // counter gate time, ms
+	uint16_t      counterAvg;    // periods or pulses averaged by the counter
+	uint8_t       calRef;        // index of the reference frequency for the automatic calibration
+	uint8_t       syncPhase;     // phase of the sync edge [0..255]/256 of the period
+	uint8_t       syncDuty;      // sync high time [1..255]/256 of the period
+	uint8_t       startPhase;    // phase of the first sample [0..255]/256 of the period
+	bool          finishPeriod;  // on stop, finish the period before the output goes to offLevel
+	double        fskFreq;       // FSK frequency for the high HS input, Hz
+	uint8_t       pskPhase;      // PSK phase shift for the high HS input [0..255]/256 of the period
+	uint8_t       dtmfDigit;     // last selected DTMF digit, index in DTMF_DIGITS
+	double        toneFreq1;     // dual tone: first tone, Hz
+	double        toneFreq2;     // dual tone: second tone, Hz
+	enum ShapeType shapeType;
+	uint8_t       shapeSymmetry; // rising part of the sine and the triangle [1..255]/256 of the period
+	uint8_t       shapeDuty;     // high part of the pulse [1..255]/256 of the period
+	uint16_t      harmAmp[HARMONICS];   // harmonic amplitudes [0..MAX_HARM_AMP], H1 first
+	uint8_t       harmPhase[HARMONICS]; // harmonic phases [0..255]/256 of the harmonic period
+	uint16_t      streamRate;    // sample rate of the USART stream, Hz
+	uint8_t       recordNum;     // index in RECORDS
+	bool          recordLoop;    // repeat the record, otherwise play it once per start
+	double        recordRate;    // record playback sample rate, Hz
+	uint16_t      libraryEntry;  // selected entry of the SPI flash library
 };
 
 struct Config config = {
@@ -213,164 +558,72 @@ struct Config config = {
 	.pulse        = 1.0,
 	.syncOut      = SyncOut_Off,
 	.triggerDelay = 0.0,
+	.triggerEdge  = TriggerEdge_High,
+	.triggerHoldoff = 0.0,
+	.burst        = 0,
+	.burstRearm   = false,
+	.gateHold     = false,
+	.trainPeriod  = 1.0,
+	.trainWidth   = 0.5,
+	.trainCount   = 0,
+	.trainDelay   = 0.0,
+	.hsClock      = 1000000.0,
+	.pwmHrFreq    = 1000.0,
+	.pwmHrDuty    = 0.5,
+	.pwmPhaseCorrect = false,
+	.pwmFine      = false,
+	.pwmFineDuty  = 32768,
+	.hsLock       = false,
+	.hsBurst      = 0,
+	.counterMode  = CounterMode_Freq,
+	.counterGate  = 1000,
+	.counterAvg   = 1,
+	.calRef       = 0,           // 1 PPS
+	.syncPhase    = 0,
+	.syncDuty     = 128,
+	.startPhase   = 0,
+	.finishPeriod = false,
+	.fskFreq      = 2000.0,
+	.pskPhase     = 128,         // 180 deg
+	.dtmfDigit    = 0,           // '1'
+	.toneFreq1    = 697.0,
+	.toneFreq2    = 1209.0,
+	.shapeType    = ShapeType_Triangle,
+	.shapeSymmetry = 128,
+	.shapeDuty    = 128,
+	.harmAmp      = { MAX_HARM_AMP }, // pure sine
+	.harmPhase    = { 0 },
+	.streamRate   = 8000,
+	.recordNum    = 0,
+	.recordLoop   = true,
+	.recordRate   = RECORD0_RATE,
+	.libraryEntry = 0,
 };
 
 volatile bool running; // generator on/off
 
-//define signals
-const uint8_t SINE_WAVE[] PROGMEM = {
-	0x80,0x83,0x86,0x89,0x8c,0x8f,0x92,0x95,0x98,0x9c,0x9f,0xa2,0xa5,0xa8,0xab,0xae,
-	0xb0,0xb3,0xb6,0xb9,0xbc,0xbf,0xc1,0xc4,0xc7,0xc9,0xcc,0xce,0xd1,0xd3,0xd5,0xd8,
-	0xda,0xdc,0xde,0xe0,0xe2,0xe4,0xe6,0xe8,0xea,0xec,0xed,0xef,0xf0,0xf2,0xf3,0xf5,
-	0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfc,0xfd,0xfe,0xfe,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xfe,0xfe,0xfd,0xfc,0xfc,0xfb,0xfa,0xf9,0xf8,0xf7,
-	0xf6,0xf5,0xf3,0xf2,0xf0,0xef,0xed,0xec,0xea,0xe8,0xe6,0xe4,0xe2,0xe0,0xde,0xdc,
-	0xda,0xd8,0xd5,0xd3,0xd1,0xce,0xcc,0xc9,0xc7,0xc4,0xc1,0xbf,0xbc,0xb9,0xb6,0xb3,
-	0xb0,0xae,0xab,0xa8,0xa5,0xa2,0x9f,0x9c,0x98,0x95,0x92,0x8f,0x8c,0x89,0x86,0x83,
-	0x80,0x7c,0x79,0x76,0x73,0x70,0x6d,0x6a,0x67,0x63,0x60,0x5d,0x5a,0x57,0x54,0x51,
-	0x4f,0x4c,0x49,0x46,0x43,0x40,0x3e,0x3b,0x38,0x36,0x33,0x31,0x2e,0x2c,0x2a,0x27,
-	0x25,0x23,0x21,0x1f,0x1d,0x1b,0x19,0x17,0x15,0x13,0x12,0x10,0x0f,0x0d,0x0c,0x0a,
-	0x09,0x08,0x07,0x06,0x05,0x04,0x03,0x03,0x02,0x01,0x01,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x02,0x03,0x03,0x04,0x05,0x06,0x07,0x08,
-	0x09,0x0a,0x0c,0x0d,0x0f,0x10,0x12,0x13,0x15,0x17,0x19,0x1b,0x1d,0x1f,0x21,0x23,
-	0x25,0x27,0x2a,0x2c,0x2e,0x31,0x33,0x36,0x38,0x3b,0x3e,0x40,0x43,0x46,0x49,0x4c,
-	0x4f,0x51,0x54,0x57,0x5a,0x5d,0x60,0x63,0x67,0x6a,0x6d,0x70,0x73,0x76,0x79,0x7c
-};
-
-const uint8_t SQUARE_WAVE[] PROGMEM = {
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,0x00,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,
-};
-
-const uint8_t SAWTOOTH_WAVE[] PROGMEM = {
-	0x00,0x01,0x02,0x03,0x04,0x05,0x06,0x07,0x08,0x09,0x0a,0x0b,0x0c,0x0d,0x0e,0x0f,
-	0x10,0x11,0x12,0x13,0x14,0x15,0x16,0x17,0x18,0x19,0x1a,0x1b,0x1c,0x1d,0x1e,0x1f,
-	0x20,0x21,0x22,0x23,0x24,0x25,0x26,0x27,0x28,0x29,0x2a,0x2b,0x2c,0x2d,0x2e,0x2f,
-	0x30,0x31,0x32,0x33,0x34,0x35,0x36,0x37,0x38,0x39,0x3a,0x3b,0x3c,0x3d,0x3e,0x3f,
-	0x40,0x41,0x42,0x43,0x44,0x45,0x46,0x47,0x48,0x49,0x4a,0x4b,0x4c,0x4d,0x4e,0x4f,
-	0x50,0x51,0x52,0x53,0x54,0x55,0x56,0x57,0x58,0x59,0x5a,0x5b,0x5c,0x5d,0x5e,0x5f,
-	0x60,0x61,0x62,0x63,0x64,0x65,0x66,0x67,0x68,0x69,0x6a,0x6b,0x6c,0x6d,0x6e,0x6f,
-	0x70,0x71,0x72,0x73,0x74,0x75,0x76,0x77,0x78,0x79,0x7a,0x7b,0x7c,0x7d,0x7e,0x7f,
-	0x80,0x81,0x82,0x83,0x84,0x85,0x86,0x87,0x88,0x89,0x8a,0x8b,0x8c,0x8d,0x8e,0x8f,
-	0x90,0x91,0x92,0x93,0x94,0x95,0x96,0x97,0x98,0x99,0x9a,0x9b,0x9c,0x9d,0x9e,0x9f,
-	0xa0,0xa1,0xa2,0xa3,0xa4,0xa5,0xa6,0xa7,0xa8,0xa9,0xaa,0xab,0xac,0xad,0xae,0xaf,
-	0xb0,0xb1,0xb2,0xb3,0xb4,0xb5,0xb6,0xb7,0xb8,0xb9,0xba,0xbb,0xbc,0xbd,0xbe,0xbf,
-	0xc0,0xc1,0xc2,0xc3,0xc4,0xc5,0xc6,0xc7,0xc8,0xc9,0xca,0xcb,0xcc,0xcd,0xce,0xcf,
-	0xd0,0xd1,0xd2,0xd3,0xd4,0xd5,0xd6,0xd7,0xd8,0xd9,0xda,0xdb,0xdc,0xdd,0xde,0xdf,
-	0xe0,0xe1,0xe2,0xe3,0xe4,0xe5,0xe6,0xe7,0xe8,0xe9,0xea,0xeb,0xec,0xed,0xee,0xef,
-	0xf0,0xf1,0xf2,0xf3,0xf4,0xf5,0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfd,0xfe,0xff
-};
-
-const uint8_t REV_SAWTOOTH_WAVE[] PROGMEM = {
-	0xff,0xfe,0xfd,0xfc,0xfb,0xfa,0xf9,0xf8,0xf7,0xf6,0xf5,0xf4,0xf3,0xf2,0xf1,0xf0,
-	0xef,0xee,0xed,0xec,0xeb,0xea,0xe9,0xe8,0xe7,0xe6,0xe5,0xe4,0xe3,0xe2,0xe1,0xe0,
-	0xdf,0xde,0xdd,0xdc,0xdb,0xda,0xd9,0xd8,0xd7,0xd6,0xd5,0xd4,0xd3,0xd2,0xd1,0xd0,
-	0xcf,0xce,0xcd,0xcc,0xcb,0xca,0xc9,0xc8,0xc7,0xc6,0xc5,0xc4,0xc3,0xc2,0xc1,0xc0,
-	0xbf,0xbe,0xbd,0xbc,0xbb,0xba,0xb9,0xb8,0xb7,0xb6,0xb5,0xb4,0xb3,0xb2,0xb1,0xb0,
-	0xaf,0xae,0xad,0xac,0xab,0xaa,0xa9,0xa8,0xa7,0xa6,0xa5,0xa4,0xa3,0xa2,0xa1,0xa0,
-	0x9f,0x9e,0x9d,0x9c,0x9b,0x9a,0x99,0x98,0x97,0x96,0x95,0x94,0x93,0x92,0x91,0x90,
-	0x8f,0x8e,0x8d,0x8c,0x8b,0x8a,0x89,0x88,0x87,0x86,0x85,0x84,0x83,0x82,0x81,0x80,
-	0x7f,0x7e,0x7d,0x7c,0x7b,0x7a,0x79,0x78,0x77,0x76,0x75,0x74,0x73,0x72,0x71,0x70,
-	0x6f,0x6e,0x6d,0x6c,0x6b,0x6a,0x69,0x68,0x67,0x66,0x65,0x64,0x63,0x62,0x61,0x60,
-	0x5f,0x5e,0x5d,0x5c,0x5b,0x5a,0x59,0x58,0x57,0x56,0x55,0x54,0x53,0x52,0x51,0x50,
-	0x4f,0x4e,0x4d,0x4c,0x4b,0x4a,0x49,0x48,0x47,0x46,0x45,0x44,0x43,0x42,0x41,0x40,
-	0x3f,0x3e,0x3d,0x3c,0x3b,0x3a,0x39,0x38,0x37,0x36,0x35,0x34,0x33,0x32,0x31,0x30,
-	0x2f,0x2e,0x2d,0x2c,0x2b,0x2a,0x29,0x28,0x27,0x26,0x25,0x24,0x23,0x22,0x21,0x20,
-	0x1f,0x1e,0x1d,0x1c,0x1b,0x1a,0x19,0x18,0x17,0x16,0x15,0x14,0x13,0x12,0x11,0x10,
-	0x0f,0x0e,0x0d,0x0c,0x0b,0x0a,0x09,0x08,0x07,0x06,0x05,0x04,0x03,0x02,0x01,0x00,
-};
-
-const uint8_t TRIANGLE_WAVE[] PROGMEM = {
-	0x00,0x02,0x04,0x06,0x08,0x0a,0x0c,0x0e,0x10,0x12,0x14,0x16,0x18,0x1a,0x1c,0x1e,
-	0x20,0x22,0x24,0x26,0x28,0x2a,0x2c,0x2e,0x30,0x32,0x34,0x36,0x38,0x3a,0x3c,0x3e,
-	0x40,0x42,0x44,0x46,0x48,0x4a,0x4c,0x4e,0x50,0x52,0x54,0x56,0x58,0x5a,0x5c,0x5e,
-	0x60,0x62,0x64,0x66,0x68,0x6a,0x6c,0x6e,0x70,0x72,0x74,0x76,0x78,0x7a,0x7c,0x7e,
-	0x80,0x82,0x84,0x86,0x88,0x8a,0x8c,0x8e,0x90,0x92,0x94,0x96,0x98,0x9a,0x9c,0x9e,
-	0xa0,0xa2,0xa4,0xa6,0xa8,0xaa,0xac,0xae,0xb0,0xb2,0xb4,0xb6,0xb8,0xba,0xbc,0xbe,
-	0xc0,0xc2,0xc4,0xc6,0xc8,0xca,0xcc,0xce,0xd0,0xd2,0xd4,0xd6,0xd8,0xda,0xdc,0xde,
-	0xe0,0xe2,0xe4,0xe6,0xe8,0xea,0xec,0xee,0xf0,0xf2,0xf4,0xf6,0xf8,0xfa,0xfc,0xfe,
-	0xff,0xfd,0xfb,0xf9,0xf7,0xf5,0xf3,0xf1,0xef,0xef,0xeb,0xe9,0xe7,0xe5,0xe3,0xe1,
-	0xdf,0xdd,0xdb,0xd9,0xd7,0xd5,0xd3,0xd1,0xcf,0xcf,0xcb,0xc9,0xc7,0xc5,0xc3,0xc1,
-	0xbf,0xbd,0xbb,0xb9,0xb7,0xb5,0xb3,0xb1,0xaf,0xaf,0xab,0xa9,0xa7,0xa5,0xa3,0xa1,
-	0x9f,0x9d,0x9b,0x99,0x97,0x95,0x93,0x91,0x8f,0x8f,0x8b,0x89,0x87,0x85,0x83,0x81,
-	0x7f,0x7d,0x7b,0x79,0x77,0x75,0x73,0x71,0x6f,0x6f,0x6b,0x69,0x67,0x65,0x63,0x61,
-	0x5f,0x5d,0x5b,0x59,0x57,0x55,0x53,0x51,0x4f,0x4f,0x4b,0x49,0x47,0x45,0x43,0x41,
-	0x3f,0x3d,0x3b,0x39,0x37,0x35,0x33,0x31,0x2f,0x2f,0x2b,0x29,0x27,0x25,0x23,0x21,
-	0x1f,0x1d,0x1b,0x19,0x17,0x15,0x13,0x11,0x0f,0x0f,0x0b,0x09,0x07,0x05,0x03,0x01
-};
-
-const uint8_t ECG_WAVE[] PROGMEM = {
-	73,74,75,75,74,73,73,73,73,72,71,69,68,67,67,67,
-	68,68,67,65,62,61,59,57,56,55,55,54,54,54,55,55,
-	55,55,55,55,54,53,51,50,49,49,52,61,77,101,132,
-	169,207,238,255,254,234,198,154,109,68,37,17,5,
-	0,1,6,13,20,28,36,45,52,57,61,64,65,66,67,68,68,
-	69,70,71,71,71,71,71,71,71,71,72,72,72,73,73,74,
-	75,75,76,77,78,79,80,81,82,83,84,86,88,91,93,96,
-	98,100,102,104,107,109,112,115,118,121,123,125,
-	126,127,127,127,127,127,126,125,124,121,119,116,
-	113,109,105,102,98,95,92,89,87,84,81,79,77,76,75,
-	74,73,72,70,69,68,67,67,67,68,68,68,69,69,69,69,
-	69,69,69,70,71,72,73,73,74,74,75,75,75,75,75,75,
-	74,74,73,73,73,73,72,72,72,71,71,71,71,71,71,71,
-	70,70,70,69,69,69,69,69,70,70,70,69,68,68,67,67,
-	67,67,66,66,66,65,65,65,65,65,65,65,65,64,64,63,
-	63,64,64,65,65,65,65,65,65,65,64,64,64,64,64,64,
-	64,64,65,65,65,66,67,68,69,71,72,73
-};
-
-const uint8_t SINE_WAVE_FROM_ZERO[] PROGMEM = { //sine 256 values, start from 0
-	0x00,0x00,0x00,0x00,0x00,
-	0x00,0x00,0x00,0x00,0x00,0x00,0x01,0x01,0x02,0x03,0x03,0x04,0x05,0x06,0x07,0x08,
-	0x09,0x0a,0x0c,0x0d,0x0f,0x10,0x12,0x13,0x15,0x17,0x19,0x1b,0x1d,0x1f,0x21,0x23,
-	0x25,0x27,0x2a,0x2c,0x2e,0x31,0x33,0x36,0x38,0x3b,0x3e,0x40,0x43,0x46,0x49,0x4c,
-	0x4f,0x51,0x54,0x57,0x5a,0x5d,0x60,0x63,0x67,0x6a,0x6d,0x70,0x73,0x76,0x79,0x7c,
-	0x80,0x83,0x86,0x89,0x8c,0x8f,0x92,0x95,0x98,0x9c,0x9f,0xa2,0xa5,0xa8,0xab,0xae,
-	0xb0,0xb3,0xb6,0xb9,0xbc,0xbf,0xc1,0xc4,0xc7,0xc9,0xcc,0xce,0xd1,0xd3,0xd5,0xd8,
-	0xda,0xdc,0xde,0xe0,0xe2,0xe4,0xe6,0xe8,0xea,0xec,0xed,0xef,0xf0,0xf2,0xf3,0xf5,
-	0xf6,0xf7,0xf8,0xf9,0xfa,0xfb,0xfc,0xfc,0xfd,0xfe,0xfe,0xff,0xff,0xff,0xff,0xff,
-	0xff,0xff,0xff,0xff,0xff,0xff,0xfe,0xfe,0xfd,0xfc,0xfc,0xfb,0xfa,0xf9,0xf8,0xf7,
-	0xf6,0xf5,0xf3,0xf2,0xf0,0xef,0xed,0xec,0xea,0xe8,0xe6,0xe4,0xe2,0xe0,0xde,0xdc,
-	0xda,0xd8,0xd5,0xd3,0xd1,0xce,0xcc,0xc9,0xc7,0xc4,0xc1,0xbf,0xbc,0xb9,0xb6,0xb3,
-	0xb0,0xae,0xab,0xa8,0xa5,0xa2,0x9f,0x9c,0x98,0x95,0x92,0x8f,0x8c,0x89,0x86,0x83,
-	0x80,0x7c,0x79,0x76,0x73,0x70,0x6d,0x6a,0x67,0x63,0x60,0x5d,0x5a,0x57,0x54,0x51,
-	0x4f,0x4c,0x49,0x46,0x43,0x40,0x3e,0x3b,0x38,0x36,0x33,0x31,0x2e,0x2c,0x2a,0x27,
-	0x25,0x23,0x21,0x1f,0x1d,0x1b,0x19,0x17,0x15,0x13,0x12,0x10,0x0f,0x0d,0x0c,0x0a,
-	0x09,0x08,0x07,0x06,0x05,0x04,0x03,0x03,0x02,0x01,0x01
+//define signals: SINE_WAVE, SQUARE_WAVE, ..., NOISE_SIGNAL and QUARTER_SINE are in waves.h,
+//the wave tables are compressed, see expandWave()
+
+// DTMF: the digit row selects the low tone, the column selects the high tone
+const char DTMF_DIGITS[] PROGMEM = "123A456B789C*0#D";
+const uint16_t DTMF_LOW[]  PROGMEM = { 697, 770, 852, 941 };
+const uint16_t DTMF_HIGH[] PROGMEM = { 1209, 1336, 1477, 1633 };
+
+#if RECORD_PLAYBACK
+// long records of waves.h (RECORDS in the Makefile), played straight from flash
+struct Record {
+	const char    *name;         // 13 characters of the LCD
+	const uint8_t *data;
+	uint16_t       size;
+	uint16_t       rate;         // recorded sample rate, Hz
 };
 
-const uint8_t NOISE_SIGNAL[] PROGMEM = {
-	0x0a,0x0e,0x2d,0x73,0xc4,0x40,0xaa,0x8f,0xdd,0xf3,0x6b,0x97,0xb9,0x8d,0x77,0x57,
-	0xe3,0x52,0x93,0x3f,0x25,0x07,0x99,0x5f,0x8b,0x37,0x30,0x7b,0x3a,0x89,0xc6,0xae,
-	0x4e,0x58,0xe4,0x4b,0x48,0x05,0xd6,0xf2,0x5c,0x44,0xef,0xf8,0x69,0xf6,0x92,0x56,
-	0x1d,0x96,0xab,0x2f,0x88,0x35,0xf5,0x36,0x83,0xfc,0x8e,0x60,0xe0,0xda,0xa8,0x5b,
-	0xdf,0x7e,0x4d,0x3b,0x38,0x91,0x2b,0xfa,0x21,0xc2,0x23,0x0d,0x2e,0xce,0x3c,0xb6,
-	0x03,0x32,0xed,0x86,0xe6,0x0f,0x55,0x6a,0x34,0xb8,0x70,0x45,0x49,0x9b,0x76,0xbc,
-	0x18,0x5a,0x41,0x46,0x28,0xfd,0x2c,0xb0,0xea,0xb2,0xde,0x65,0xbb,0x10,0x59,0xf1,
-	0x9d,0xb7,0x29,0xd4,0xeb,0x42,0x85,0x6f,0x39,0xd5,0x26,0x90,0x7f,0xa7,0xe8,0xd9,
-	0x98,0xc1,0x8c,0x11,0x62,0xad,0x81,0x66,0x0c,0x5d,0x19,0x01,0x1e,0xc8,0x87,0xe1,
-	0x2a,0xd2,0x24,0xd1,0x43,0xe7,0x4f,0x68,0xc0,0xaf,0x5e,0x9e,0x84,0xe2,0x50,0xcb,
-	0x1a,0xc3,0xb4,0x74,0x04,0xac,0x64,0xa0,0x13,0xd3,0x31,0x00,0x9c,0xfe,0x4a,0xb3,
-	0x78,0x15,0x3e,0xee,0x94,0x7c,0x1c,0x72,0xa1,0x20,0x9f,0x95,0xcf,0x3d,0x82,0xb5,
-	0xbd,0x54,0xa6,0x47,0x6e,0x75,0xc7,0x1b,0xd7,0x09,0x16,0xf0,0x12,0x02,0xb1,0x06,
-	0x4c,0xcd,0xa9,0xa2,0x6c,0xa5,0x61,0xca,0x7d,0x1f,0x22,0x17,0x14,0xc5,0xd8,0x6d,
-	0x8a,0xf7,0x51,0xa3,0xfb,0xf4,0x63,0xbf,0x79,0xc9,0x27,0xec,0x7a,0x9a,0xbe,0x80,
-	0xff,0xe5,0xba,0xcc,0x0b,0xdb,0xdc,0xf9,0x67,0xe9,0xa4,0x08,0xd0,0x71,0x33,0x53
+const struct Record RECORDS[] PROGMEM = {
+	RECORD_LIST
 };
+static const uint8_t RECORDS_SIZE = (sizeof(RECORDS)/sizeof(RECORDS[0]));
+#endif
 
 const uint8_t * const SIGNALS[] PROGMEM = {
 	SINE_WAVE,
@@ -378,6 +631,8 @@ const uint8_t * const SIGNALS[] PROGMEM = {
 	TRIANGLE_WAVE,
 	SAWTOOTH_WAVE,
 	REV_SAWTOOTH_WAVE,
+	SQUARE_BL_WAVE,
+	SAWTOOTH_BL_WAVE,
 	ECG_WAVE
 };
 
@@ -386,6 +641,8 @@ const char SQUARE_TITLE[]    PROGMEM = "     Square     ";
 const char TRIANGLE_TITLE[]  PROGMEM = "    Triangle    ";
 const char SAW_TITLE[]       PROGMEM = "    SawTooth    ";
 const char REV_SAW_TITLE[]   PROGMEM = "  Rev SawTooth  ";
+const char SQUARE_BL_TITLE[] PROGMEM = "   Square BL    ";
+const char SAW_BL_TITLE[]    PROGMEM = "  SawTooth BL   ";
 const char ECG_TITLE[]       PROGMEM = "      ECG       ";
 const char FREQ_STEP_TITLE[] PROGMEM = "   Freq Step    ";
 const char FREQ_MODE_TITLE[] PROGMEM = "   Freq Mode    ";
@@ -401,6 +658,66 @@ const char OFF_LEVEL_TITLE[] PROGMEM = "   Off Level    ";
 const char SYNC_OUT_TITLE[]  PROGMEM = "  Sync Output   ";
 const char TRIGGER_TITLE[]   PROGMEM = " Trigger Delay  ";
 const char CAL_FREQ_TITLE[]  PROGMEM = " Calibrate Freq ";
+#if SYNTH
+const char SHAPE_TITLE[]     PROGMEM = "Shape           ";
+const char SHAPE_TYPE_TITLE[] PROGMEM = "     Shape      ";
+const char SHAPE_SYM_TITLE[] PROGMEM = " Shape Symmetry ";
+const char SHAPE_DUTY_TITLE[] PROGMEM = "   Shape Duty   ";
+const char HARMONICS_TITLE[] PROGMEM = "   Harmonics    ";
+const char HARMONIC_TITLE[]  PROGMEM = "    Harmonic    ";
+const char HARM_AMP_TITLE[]  PROGMEM = " Harmonic Level ";
+const char HARM_PHASE_TITLE[] PROGMEM = " Harmonic Phase ";
+#endif
+#if REMOTE
+const char ARB_TITLE[]       PROGMEM = "      ARB       ";
+const char STREAM_TITLE[]    PROGMEM = "     Stream     ";
+#endif
+#if TIMER1_MODES
+const char HS_CLOCK_TITLE[]  PROGMEM = "HS Clock        ";
+const char PWM_HR_TITLE[]    PROGMEM = "PWM             ";
+const char PWM_MODE_TITLE[]  PROGMEM = "    PWM Mode    ";
+const char TRAIN_TITLE[]     PROGMEM = "  Pulse Train   ";
+const char TRAIN_WIDTH_TITLE[] PROGMEM = " Train    Width ";
+const char TRAIN_COUNT_TITLE[] PROGMEM = " Train    Count ";
+const char TRAIN_DELAY_TITLE[] PROGMEM = " Train    Delay ";
+const char HS_LOCK_TITLE[]   PROGMEM = "  HS Phase Lock ";
+const char HS_BURST_TITLE[]  PROGMEM = " HS Clock Burst ";
+#endif
+#if MODULATION
+const char DUAL_TONE_TITLE[] PROGMEM = "   Dual Tone    ";
+const char TONE1_TITLE[]     PROGMEM = " Dual Tone   F1 ";
+const char TONE2_TITLE[]     PROGMEM = " Dual Tone   F2 ";
+const char SYNC_PHASE_TITLE[] PROGMEM = "   Sync Phase   ";
+const char SYNC_DUTY_TITLE[] PROGMEM = "   Sync Duty    ";
+const char FSK_FREQ_TITLE[]  PROGMEM = "    FSK Freq    ";
+const char PSK_PHASE_TITLE[] PROGMEM = "   PSK Phase    ";
+#endif
+#if TRIGGER_MODES
+const char TRG_EDGE_TITLE[]  PROGMEM = "  Trigger Edge  ";
+const char HOLDOFF_TITLE[]   PROGMEM = "Trigger Holdoff ";
+const char BURST_TITLE[]     PROGMEM = "     Burst      ";
+const char REARM_TITLE[]     PROGMEM = "  Burst Rearm   ";
+const char GATE_HOLD_TITLE[] PROGMEM = " Gate Low Output";
+#endif
+#if PHASE_CONTROL
+const char PWM_FINE_TITLE[]  PROGMEM = " Analog PWM Duty";
+const char START_PHASE_TITLE[] PROGMEM = "  Start Phase   ";
+const char STOP_MODE_TITLE[] PROGMEM = "      Stop      ";
+#endif
+#if RECORD_PLAYBACK
+const char RECORD_TITLE[]    PROGMEM = "     Record     ";
+const char RECORD_MODE_TITLE[] PROGMEM = " Record    Mode ";
+const char RECORD_RATE_TITLE[] PROGMEM = " Record    Rate ";
+#endif
+#if LIBRARY
+const char LIBRARY_TITLE[]   PROGMEM = "    Library     ";
+#endif
+#if COUNTER
+const char AUTO_CAL_TITLE[]  PROGMEM = " Auto Calibrate ";
+const char COUNTER_TITLE[]   PROGMEM = "Counter         ";
+const char CNT_GATE_TITLE[]  PROGMEM = "  Counter Gate  ";
+const char CNT_AVG_TITLE[]   PROGMEM = "Counter Average ";
+#endif
 
 const struct MenuEntry MENU[] PROGMEM = {
 	{
@@ -468,6 +785,32 @@ const struct MenuEntry MENU[] PROGMEM = {
 			menu_onOpt,
 		}
 	},
+	{
+		SQUARE_BL_TITLE,
+		SQUARE_BL_WAVE,
+		signal_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			signal_onLeft,
+			signal_onRight,
+			signal_onStart,
+			menu_onOpt,
+		}
+	},
+	{
+		SAW_BL_TITLE,
+		SAWTOOTH_BL_WAVE,
+		signal_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			signal_onLeft,
+			signal_onRight,
+			signal_onStart,
+			menu_onOpt,
+		}
+	},
 	{
 		ECG_TITLE,
 		ECG_WAVE,
@@ -481,6 +824,62 @@ const struct MenuEntry MENU[] PROGMEM = {
 			menu_onOpt,
 		}
 	},
+#if SYNTH
+	{
+		SHAPE_TITLE,
+		NULL,                        // signalBuffer is filled by shape_fill()
+		shape_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			signal_onLeft,
+			signal_onRight,
+			signal_onStart,
+			menu_onOpt,
+		}
+	},
+	{
+		HARMONICS_TITLE,
+		NULL,
+		signal_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			signal_onLeft,
+			signal_onRight,
+			harmonics_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
+#if REMOTE
+	{
+		ARB_TITLE,
+		NULL,                        // signalBuffer is uploaded over the USART or loaded from EEPROM
+		signal_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			signal_onLeft,
+			signal_onRight,
+			arb_onStart,
+			menu_onOpt,
+		}
+	},
+	{
+		STREAM_TITLE,
+		NULL,                        // signalBuffer is the receive ring
+		stream_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			stream_onLeft,
+			stream_onRight,
+			stream_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
 	{
 		NOISE_TITLE,
 		NULL,
@@ -520,6 +919,21 @@ const struct MenuEntry MENU[] PROGMEM = {
 			menu_onOpt,
 		}
 	},
+#if TIMER1_MODES
+	{
+		HS_CLOCK_TITLE,
+		NULL,
+		hsClock_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			hsClock_onLeft,
+			hsClock_onRight,
+			hsClock_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
 	{
 		PWM_TITLE,
 		NULL,
@@ -546,6 +960,21 @@ const struct MenuEntry MENU[] PROGMEM = {
 			menu_onOpt,
 		}
 	},
+#if TIMER1_MODES
+	{
+		PWM_HR_TITLE,
+		NULL,
+		pwmHr_updateDisplay,
+		{
+			pwmHr_onUp,
+			pwmHr_onDown,
+			pwmHr_onLeft,
+			pwmHr_onRight,
+			pwmHr_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
 	{
 		SWEEP_TITLE,
 		NULL,
@@ -559,6 +988,81 @@ const struct MenuEntry MENU[] PROGMEM = {
 			menu_onOpt,
 		}
 	},
+#if TIMER1_MODES
+	{
+		TRAIN_TITLE,
+		NULL,
+		train_updateDisplay,
+		{
+			train_onUp,
+			train_onDown,
+			train_onLeft,
+			train_onRight,
+			train_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
+#if MODULATION
+	{
+		DUAL_TONE_TITLE,
+		NULL,
+		dualTone_updateDisplay,
+		{
+			dualTone_onUp,
+			dualTone_onDown,
+			dualTone_onLeft,
+			dualTone_onRight,
+			dualTone_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
+#if RECORD_PLAYBACK
+	{
+		RECORD_TITLE,
+		NULL,
+		record_updateDisplay,
+		{
+			record_onUp,
+			record_onDown,
+			record_onLeft,
+			record_onRight,
+			record_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
+#if LIBRARY
+	{
+		LIBRARY_TITLE,
+		NULL,                        // signalBuffer is read from the SPI flash
+		library_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			library_onLeft,
+			library_onRight,
+			library_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
+#if COUNTER
+	{
+		COUNTER_TITLE,
+		NULL,
+		counter_updateDisplay,
+		{
+			menu_onUp,
+			menu_onDown,
+			counter_onLeft,
+			counter_onRight,
+			counter_onStart,
+			menu_onOpt,
+		}
+	},
+#endif
 };
 static const uint8_t MENU_SIZE = (sizeof(MENU)/sizeof(MENU[0]));
 
@@ -615,6 +1119,170 @@ const struct MenuEntry OPT_MENU[] PROGMEM = {
 			syncOut_onOpt,
 		}
 	},
+#if MODULATION
+	{
+		SYNC_PHASE_TITLE,
+		NULL,
+		syncPhase_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			syncPhase_onLeft,
+			syncPhase_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		SYNC_DUTY_TITLE,
+		NULL,
+		syncDuty_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			syncDuty_onLeft,
+			syncDuty_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if SYNTH
+	{
+		SHAPE_TYPE_TITLE,
+		NULL,
+		shapeType_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			shapeType_onLeft,
+			shapeType_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		SHAPE_SYM_TITLE,
+		NULL,
+		shapeSymmetry_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			shapeSymmetry_onLeft,
+			shapeSymmetry_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		SHAPE_DUTY_TITLE,
+		NULL,
+		shapeDuty_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			shapeDuty_onLeft,
+			shapeDuty_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		HARMONIC_TITLE,
+		NULL,
+		harmonic_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			harmonic_onLeft,
+			harmonic_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		HARM_AMP_TITLE,
+		NULL,
+		harmAmp_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			harmAmp_onLeft,
+			harmAmp_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		HARM_PHASE_TITLE,
+		NULL,
+		harmPhase_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			harmPhase_onLeft,
+			harmPhase_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if PHASE_CONTROL
+	{
+		START_PHASE_TITLE,
+		NULL,
+		startPhase_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			startPhase_onLeft,
+			startPhase_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		STOP_MODE_TITLE,
+		NULL,
+		stopMode_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			stopMode_onLeft,
+			stopMode_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if MODULATION
+	{
+		FSK_FREQ_TITLE,
+		NULL,
+		fskFreq_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			fskFreq_onLeft,
+			fskFreq_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		PSK_PHASE_TITLE,
+		NULL,
+		pskPhase_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			pskPhase_onLeft,
+			pskPhase_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
 	{
 		TRIGGER_TITLE,
 		NULL,
@@ -628,33 +1296,206 @@ const struct MenuEntry OPT_MENU[] PROGMEM = {
 			optMenu_onOpt,
 		}
 	},
+#if TRIGGER_MODES
 	{
-		CAL_FREQ_TITLE,
+		TRG_EDGE_TITLE,
 		NULL,
-		calFreq_updateDisplay,
+		triggerEdge_updateDisplay,
 		{
 			optMenu_onUp,
 			optMenu_onDown,
-			calFreq_onLeft,
-			calFreq_onRight,
-			calFreq_onStart,
+			triggerEdge_onLeft,
+			triggerEdge_onRight,
+			optMenu_onOpt,
 			optMenu_onOpt,
 		}
 	},
-};
-static const uint8_t OPT_MENU_SIZE = (sizeof(OPT_MENU)/sizeof(OPT_MENU[0]));
-
-//various LCD strings
-const char MNON[]   PROGMEM = "ON ";
-const char MNOFF[]  PROGMEM = "OFF";
-const char MNDIS[]  PROGMEM = "DIS";
-const char MNTRIG[] PROGMEM = "TRG";
-const char RND[]    PROGMEM = "    Random";
-
-enum Button {
-	Button_None,
-	Button_Up,
-	Button_Right,
+	{
+		HOLDOFF_TITLE,
+		NULL,
+		holdoff_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			holdoff_onLeft,
+			holdoff_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		BURST_TITLE,
+		NULL,
+		burst_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			burst_onLeft,
+			burst_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		REARM_TITLE,
+		NULL,
+		burstRearm_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			burstRearm_onLeft,
+			burstRearm_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		GATE_HOLD_TITLE,
+		NULL,
+		gateHold_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			gateHold_onLeft,
+			gateHold_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if TIMER1_MODES
+	{
+		PWM_MODE_TITLE,
+		NULL,
+		pwmMode_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			pwmMode_onLeft,
+			pwmMode_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if PHASE_CONTROL
+	{
+		PWM_FINE_TITLE,
+		NULL,
+		pwmFine_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			pwmFine_onLeft,
+			pwmFine_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if TIMER1_MODES
+	{
+		HS_LOCK_TITLE,
+		NULL,
+		hsLock_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			hsLock_onLeft,
+			hsLock_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		HS_BURST_TITLE,
+		NULL,
+		hsBurst_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			hsBurst_onLeft,
+			hsBurst_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+#if COUNTER
+	{
+		CNT_GATE_TITLE,
+		NULL,
+		counterGate_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			counterGate_onLeft,
+			counterGate_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+	{
+		CNT_AVG_TITLE,
+		NULL,
+		counterAvg_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			counterAvg_onLeft,
+			counterAvg_onRight,
+			optMenu_onOpt,
+			optMenu_onOpt,
+		}
+	},
+#endif
+	{
+		CAL_FREQ_TITLE,
+		NULL,
+		calFreq_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			calFreq_onLeft,
+			calFreq_onRight,
+			calFreq_onStart,
+			optMenu_onOpt,
+		}
+	},
+#if COUNTER
+	{
+		AUTO_CAL_TITLE,
+		NULL,
+		autoCal_updateDisplay,
+		{
+			optMenu_onUp,
+			optMenu_onDown,
+			autoCal_onLeft,
+			autoCal_onRight,
+			autoCal_onStart,
+			optMenu_onOpt,
+		}
+	},
+#endif
+};
+static const uint8_t OPT_MENU_SIZE = (sizeof(OPT_MENU)/sizeof(OPT_MENU[0]));
+
+//various LCD strings
+const char MNON[]   PROGMEM = "ON ";
+const char MNOFF[]  PROGMEM = "OFF";
+const char MNDIS[]  PROGMEM = "DIS";
+const char MNTRIG[] PROGMEM = "TRG";
+const char MNGATE[] PROGMEM = "GAT";
+#if MODULATION
+const char MNFSK[]  PROGMEM = "FSK";
+const char MNPSK[]  PROGMEM = "PSK";
+#endif
+const char RND[]    PROGMEM = "    Random";
+
+enum Button {
+	Button_None,
+	Button_Up,
+	Button_Right,
 	Button_Down,
 	Button_Left,
 	Button_Start,
@@ -678,18 +1519,124 @@ static const uint16_t BUTTON_AUTO_REPEAT = 8;
 uint8_t optMenuEntryNum = (uint8_t)-1;   // active opt-menu entry or -1 if not in the opt-menu
 struct MenuEntry menuEntry;              // copy of active menu entry
 struct ButtonHandlers * buttonHandlers;
-uint8_t submenuLevel = 0;                // used by the seep only
+uint8_t submenuLevel = 0;                // used by the sweep and the pulse train only
+uint8_t harmonic = 0;                    // harmonic edited in the opt-menu, 0 - H1
+
+const uint16_t TIMER1_DIVS[] PROGMEM = { 1, 8, 64, 256, 1024 }; // Timer1 prescallers
+const uint16_t CAL_REFS[] PROGMEM = { 1, 10, 100, 1000, 10000 }; // automatic calibration references, Hz
+const uint16_t STREAM_RATES[] PROGMEM = { 1000, 2000, 4000, 8000, 11025 }; // stream rates of Left/Right, Hz
+volatile uint16_t pulsesLeft;            // pulses of the train, counted by TIMER1_COMPB_vect
+volatile uint32_t hsTogglesLeft;         // HS clock edges of the burst, counted by TIMER1_COMPA_vect
+volatile uint16_t t1Overflows;           // upper word of Timer1 for the counter
+volatile uint16_t gateMsLeft;            // counter gate time, counted by TIMER0_COMP_vect
+volatile uint16_t capturesLeft;          // periods or pulses to measure, counted by TIMER1_CAPT_vect
+volatile uint32_t captureSum;            // measured ticks
+uint32_t captureStart;                   // time of the first edge of the period or of the pulse
+volatile bool captureStarted;            // the first edge of the period mode is captured
+volatile bool captureWidth;              // pulse width is measured, otherwise the period
+double counterValue;                     // last measured value: Hz or s
 
 uint8_t signalBuffer[SIGNAL_BUFFER_SIZE]
 	__attribute__ ((aligned(SIGNAL_BUFFER_SIZE)))
 	__attribute__ ((section (".noinit")));
 
+#if REMOTE
+volatile bool remoteHold;                // the received commands do not stop the mode, see USART_RXC_vect
+bool arbLoaded;                          // signalBuffer holds the ARB samples, cleared when a mode fills it
+uint8_t arbSlot;                         // EEPROM slot reloaded when signalBuffer was overwritten
+#endif
+
 // adjust LCD stream fuinction to use with printf()
 static int LCDsendstream(char c , FILE *stream) {
 	LCDsendChar(c);
 	return 0;
 }
 
+// vfprintf() for the formats of this file: %[-+][width][.precision][l]{c,s,u,f} and %%, the format in
+// flash; the image links neither avr-libc's vfprintf nor its float conversion (printf_flt). %f is fixed
+// point through an unsigned long: it drops the decimals beyond its 9 digits (float has 7 anyway).
+void vprint_P(FILE *stream, const char *format, va_list ap) {
+	char c;
+	while((c = pgm_read_byte(format++)) != 0) {
+		if(c != '%') {
+			fputc(c, stream);
+			continue;
+		}
+
+		bool left = false, plus = false, isLong = false;
+		uint8_t width = 0, precision = 6;
+		uint8_t *number = &width;
+		for(;;) {
+			c = pgm_read_byte(format++);
+			if(c == '-')                  left = true;
+			else if(c == '+')             plus = true;
+			else if(c == 'l')             isLong = true;
+			else if(c == '.')             *(number = &precision) = 0;
+			else if(c >= '0' && c <= '9') *number = *number * 10 + (c - '0');
+			else break;
+		}
+
+		char buf[14];              // the characters in reverse, except %s
+		const char *s = NULL;
+		uint8_t length = 0;
+		if(c == 's') {
+			s = va_arg(ap, const char *);
+			length = strlen(s);
+		}
+		else if(c == 'u' || c == 'f') {
+			uint32_t n;
+			char sign = 0;
+			if(c == 'u') {
+				n = isLong ? va_arg(ap, uint32_t) : va_arg(ap, unsigned);
+				precision = 0;
+			}
+			else {
+				double value = va_arg(ap, double);
+				if(value < 0) {
+					value = -value;
+					sign = '-';
+				}
+				else if(plus) sign = '+';
+				for(uint8_t i = precision; i != 0; --i) value *= 10;
+				for(; value >= 4e9 && precision != 0; value /= 10) --precision;
+				n = value + 0.5;
+			}
+			do {
+				if(length == precision && precision != 0) buf[length++] = '.';
+				buf[length++] = '0' + n % 10;
+				n /= 10;
+			} while(n != 0 || length <= precision);
+			if(sign != 0) buf[length++] = sign;
+		}
+		else if(c == 'c') buf[length++] = va_arg(ap, int);
+		else if(c == '%') buf[length++] = '%';
+
+		uint8_t pad = (width > length) ? width - length : 0;
+		if(!left) for(; pad != 0; --pad) fputc(' ', stream);
+		if(s != NULL) while(length-- != 0) fputc(*s++, stream);
+		else          while(length != 0)   fputc(buf[--length], stream);
+		for(; pad != 0; --pad) fputc(' ', stream);
+	}
+}
+
+void print_P(const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	vprint_P(stdout, format, ap);
+	va_end(ap);
+}
+
+void fprint_P(FILE *stream, const char *format, ...) {
+	va_list ap;
+	va_start(ap, format);
+	vprint_P(stream, format, ap);
+	va_end(ap);
+}
+
+inline uint32_t msToTicks(double ms) {
+	return (double)(CPU_FREQ / 1000) * ms + 0.5;
+}
+
 inline uint32_t delayMsToCount(double ms) {
 	return (double)(CPU_FREQ / 1000) * ms / 6;
 }
@@ -728,16 +1675,83 @@ void timer2Stop(void) {
 
 // External interrupts service routines
 // used to stop DDS in the inline ASM by setting
-// CPHA bit in SPCR register
+// the stop flag
 ISR(INT0_vect) {
-	SPCR |= (1 << CPHA);
+	STOP_REG |= (1 << STOP_BIT);
 }
 ISR(INT1_vect) {
-	SPCR |= (1 << CPHA);
+	STOP_REG |= (1 << STOP_BIT);
 }
 ISR(INT2_vect) {
-	SPCR |= (1 << CPHA);
+	STOP_REG |= (1 << STOP_BIT);
+}
+
+#if TIMER1_MODES
+// Called in the middle of the low phase of each period of the pulse train,
+// stops the train (also by setting the stop flag) after the last pulse
+ISR(TIMER1_COMPB_vect) {
+	if(pulsesLeft == 0) {
+		TCCR1B = 0;
+		STOP_REG |= (1 << STOP_BIT);
+	}
+	else if(--pulsesLeft == 0) {
+		OCR1A = ICR1; // constant low from the next period
+	}
+}
+#endif
+
+#if COUNTER
+// Counter: the gate time is over
+ISR(TIMER0_COMP_vect) {
+	if(--gateMsLeft == 0) {
+		TCCR1B = 0;
+	}
+}
+
+ISR(TIMER1_OVF_vect) {
+	++t1Overflows;
+}
+
+// Counter: the analog comparator output is inverted (bandgap on +, input on -),
+// so the falling capture edge is the rising input edge
+ISR(TIMER1_CAPT_vect) {
+	uint16_t low  = ICR1;
+	uint16_t high = t1Overflows;
+	if(bit_is_set(TIFR, TOV1) && low < 0x8000) ++high; // the pending overflow was before the capture
+	uint32_t t = ((uint32_t)high << 16) | low;
+
+	if(captureWidth) {
+		TCCR1B ^= (1 << ICES1);      // the next capture on the other edge
+		TIFR = (1 << ICF1);
+		if(TCCR1B & (1 << ICES1)) {  // rising input edge
+			captureStart = t;
+			return;
+		}
+		captureSum += t - captureStart;
+	}
+	else if(!captureStarted) {
+		captureStarted = true;
+		captureStart = t;
+		return;
+	}
+	else {
+		captureSum = t - captureStart;
+	}
+
+	if(--capturesLeft == 0) {
+		TIMSK &= ~(1 << TICIE1);
+	}
+}
+#endif
+
+#if TIMER1_MODES
+// Called on each toggle of the HS clock burst, stops Timer1 after the last falling edge
+ISR(TIMER1_COMPA_vect) {
+	if(--hsTogglesLeft == 0) {
+		TCCR1B = 0;
+	}
 }
+#endif
 
 // called every 4.1 ms, takes ~4 us
 void checkButtons(void) {
@@ -748,10 +1762,12 @@ void checkButtons(void) {
 		newButton = Button_Up;
 	else if(bit_is_clear(BPIN, RIGHT))
 		newButton = Button_Right;
+#if !REMOTE
 	else if(bit_is_clear(BPIN, DOWN))
 		newButton = Button_Down;
 	else if(bit_is_clear(BPIN, LEFT))
 		newButton = Button_Left;
+#endif
 	else if(bit_is_clear(BPIN, START))
 		newButton = Button_Start;
 	else if(bit_is_clear(BPIN, OPT))
@@ -789,19 +1805,77 @@ void saveSettings(void) {
 	eeprom_update_block(&config, EE_CONFIG, sizeof(config));
 }
 
+// the Sync Out values built in
+#define SYNC_OUT_AVAILABLE (_BV(SyncOut_Off) | _BV(SyncOut_Single) | _BV(SyncOut_Multiple) | _BV(SyncOut_Trigger) \
+	| (TRIGGER_MODES ? _BV(SyncOut_Gate) : 0) \
+	| (TIMER1_MODES  ? _BV(SyncOut_Clock) | _BV(SyncOut_Pwm) : 0) \
+	| (MODULATION    ? _BV(SyncOut_Phase) | _BV(SyncOut_Toggle) | _BV(SyncOut_Fsk) | _BV(SyncOut_Psk) : 0))
+
+bool isSyncOutAvailable(uint8_t syncOut)
+{
+	return (syncOut < SyncOut_End) && ((SYNC_OUT_AVAILABLE >> syncOut) & 1);
+}
+
 void loadSettings(void) {
-	if(eeprom_read_byte((uint8_t*)EE_INIT) != 'T') {
+	if(eeprom_read_byte((uint8_t*)EE_INIT) != EE_INIT_MARK) {
 		// save the initial hard-coded values
 		saveSettings();
-		eeprom_write_byte((uint8_t*)EE_INIT, 'T');   // marks once that eeprom init is done
+		eeprom_write_byte((uint8_t*)EE_INIT, EE_INIT_MARK);   // marks once that eeprom init is done
 	}
 
 	eeprom_read_block(&config, EE_CONFIG, sizeof(config));
+
+	// the settings may come from a build with other options
+	if(config.menuEntry >= MENU_SIZE) config.menuEntry = 0;
+	if(!isSyncOutAvailable(config.syncOut)) config.syncOut = SyncOut_Off;
+#if RECORD_PLAYBACK
+	if(config.recordNum >= RECORDS_SIZE) config.recordNum = 0;
+#endif
+}
+
+// the HS input gates the DDS
+inline bool isGated(void)
+{
+#if TRIGGER_MODES
+	return config.syncOut == SyncOut_Gate;
+#else
+	return false;
+#endif
+}
+
+// the HS input keys the frequency or the phase of the DDS
+inline bool isKeyed(void)
+{
+#if MODULATION
+	return (config.syncOut == SyncOut_Fsk) || (config.syncOut == SyncOut_Psk);
+#else
+	return false;
+#endif
 }
 
 inline bool isHsOutputEnabled(void)
 {
-	return (config.syncOut != SyncOut_Trigger);
+	return (config.syncOut != SyncOut_Trigger) && !isGated() && !isKeyed();
+}
+
+// HS is driven by the phase of the DDS
+inline bool isPhaseSync(void)
+{
+#if MODULATION
+	return (config.syncOut == SyncOut_Phase) || (config.syncOut == SyncOut_Toggle);
+#else
+	return false;
+#endif
+}
+
+// Timer1 output on HS runs together with the DDS
+inline bool isDualOutput(void)
+{
+#if TIMER1_MODES
+	return (config.syncOut == SyncOut_Clock) || (config.syncOut == SyncOut_Pwm);
+#else
+	return false;
+#endif
 }
 
 inline void setHsDirection(void)
@@ -886,15 +1960,30 @@ void optMenu_onOpt(void) {
 }
 
 void displaySignalStatus(void) {
-	if(running)
-		CopyStringtoLCD((config.syncOut == SyncOut_Trigger) ? MNTRIG : MNON, 13, 1);
+	if(running && config.syncOut == SyncOut_Trigger)
+		CopyStringtoLCD(MNTRIG, 13, 1);
+	else if(running && isGated())
+		CopyStringtoLCD(MNGATE, 13, 1);
+#if MODULATION
+	else if(running && config.syncOut == SyncOut_Fsk)
+		CopyStringtoLCD(MNFSK, 13, 1);
+	else if(running && config.syncOut == SyncOut_Psk)
+		CopyStringtoLCD(MNPSK, 13, 1);
+#endif
+	else if(running)
+		CopyStringtoLCD(MNON, 13, 1);
 	else
 		CopyStringtoLCD(MNOFF, 13, 1);
 }
 
 void showFreq(double freq) {
 	LCDGotoXY(0, 1);
-	printf("%10.3fHz", freq);
+	print_P(PSTR("%10.3fHz"), freq);
+}
+
+// step for counters, follows the frequency step
+uint16_t countStep(void) {
+	return (config.freqStep < 1.0) ? 1 : (uint16_t)config.freqStep;
 }
 
 void signal_updateDisplay(void) {
@@ -931,6 +2020,9 @@ void enableMenu(void) {
 void signal_start(void) {
 	saveSettings();
 
+#if REMOTE
+	arbLoaded = false;
+#endif
 	running = true;
 
 	menuEntry.updateDisplay();
@@ -949,37 +2041,93 @@ double accToFreq(uint32_t acc, uint8_t ticks) {
 
 void signal_recheckButtons(void) {
 	enableMenu();
+#if REMOTE
+	remote_process();
+#endif
 	while(buttonState.pressed != Button_None) {
 		processButton();
 	}
 	disableMenu();
 }
 
-inline bool waitTrigger(void) {
-	if(config.syncOut != SyncOut_Trigger) return true;
+// number of delay loop iterations for triggerWait(), the trigger latency is compensated
+uint32_t triggerDelayCount(void) {
+	uint32_t ticks = (double)(CPU_FREQ / 1000) * config.triggerDelay;
+	if(ticks <= TRIGGER_TICKS) return 1;
+	return (ticks - TRIGGER_TICKS + 3) / 6 + 1;
+}
 
+// makes the holdoff and waits until the trigger is armed (the level before the edge);
+// returns false if interrupted, otherwise the level which fires the trigger is set in *high
+bool armTrigger(uint32_t holdoff, uint8_t *high) {
 	HSDDR &= ~_BV(HS); // configure HS as input
-	SPCR &= ~(1 << CPHA);
 
-	uint32_t count = delayMsToCount(config.triggerDelay);
-	if(count == 0) {
-		while(true) {
-			if(bit_is_set(HSPIN, HS)) return true;
-			if(bit_is_set(SPCR, CPHA)) return false;
-		}
+#if TRIGGER_MODES
+	if(holdoff != 0) delayCount(holdoff);
+
+	uint8_t level;
+	switch(config.triggerEdge) {
+		case TriggerEdge_Rising:  level = 0;               break;
+		case TriggerEdge_Falling: level = _BV(HS);         break;
+		case TriggerEdge_Both:    level = HSPIN & _BV(HS); break;
+		default:                  *high = 1;               return true;
 	}
-	else {
-		while(true) {
-			if(bit_is_set(HSPIN, HS)) break;
-			if(bit_is_set(SPCR, CPHA)) return false;
-		}
-		delayCount(count);
-		return true;
+
+	*high = !level;
+	while((HSPIN & _BV(HS)) != level) {
+		if(bit_is_set(STOP_REG, STOP_BIT)) return false;
 	}
+#else
+	*high = 1;
+#endif
+	return true;
+}
+
+bool waitTrigger(void) {
+	if(config.syncOut != SyncOut_Trigger) return true;
+
+	uint32_t count = triggerDelayCount();
+	uint8_t high;
+	STOP_REG &= ~(1 << STOP_BIT);
+	if(!armTrigger(delayMsToCount(config.triggerHoldoff), &high)) return false;
+
+	triggerWait(high, count);
+	return bit_is_clear(STOP_REG, STOP_BIT);
+}
+
+void reverseBuffer(uint8_t *begin, uint8_t *end) {
+	while(begin < end) {
+		uint8_t t = *begin;
+		*begin++ = *--end;
+		*end = t;
+	}
+}
+
+// rotates signalBuffer left by k samples in place
+void rotateBuffer(uint8_t k) {
+	if(k == 0) return;
+	reverseBuffer(signalBuffer, signalBuffer + k);
+	reverseBuffer(signalBuffer + k, signalBuffer + sizeof(signalBuffer));
+	reverseBuffer(signalBuffer, signalBuffer + sizeof(signalBuffer));
 }
 
 void signal_continue(bool tryToCorrect) {
-	uint32_t ticks = (config.syncOut == SyncOut_Multiple) ? OUT_SYNC_TICKS : OUT_TICKS;
+	bool burst = TRIGGER_MODES && (config.burst != 0) && (config.syncOut != SyncOut_Multiple) && !isGated()
+		&& !isDualOutput() && !isPhaseSync() && !isKeyed();
+	uint32_t ticks;
+	switch(config.syncOut) {
+		case SyncOut_Multiple: ticks = OUT_SYNC_TICKS;                      break;
+#if MODULATION
+		case SyncOut_Phase:    ticks = PHASE_SYNC_TICKS;                    break;
+		case SyncOut_Toggle:   ticks = TOGGLE_SYNC_TICKS;                   break;
+		case SyncOut_Fsk:      ticks = FSK_OUT_TICKS;                       break;
+		case SyncOut_Psk:      ticks = PSK_OUT_TICKS;                       break;
+#endif
+#if TRIGGER_MODES
+		case SyncOut_Gate:     ticks = GATE_OUT_TICKS;                      break;
+#endif
+		default:               ticks = burst ? BURST_OUT_TICKS : OUT_TICKS; break;
+	}
 	uint32_t acc = freqToAcc(config.freq, ticks);
 	if(acc == 0) acc = 1;
 
@@ -991,56 +2139,313 @@ void signal_continue(bool tryToCorrect) {
 		showFreq(freq);
 	}
 
-	SPCR &= ~(1 << CPHA); // clear CPHA bit in SPCR register to allow DDS
+	// index 0 of the rotated buffer is the start phase (the sync phase in the phase sync modes),
+	// so the periods of bursts and of the finishing stop are counted from it
+	uint8_t rotation = isPhaseSync() ? config.syncPhase : (PHASE_CONTROL ? config.startPhase : 0);
+	rotateBuffer(rotation);
 
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
+
+	bool finish = false;          // signalOut() was interrupted: finish the period if it is a stop
+	uint32_t phase = 0;
 	switch(config.syncOut) {
 		case SyncOut_Single:
 			syncPulse();
 			// continue
 		case SyncOut_Off:
-			signalOut(signalBuffer,
+			if(burst) {
+				burstOut(signalBuffer,
+					(uint8_t)(acc >> 24),
+					(uint8_t)(acc >> 16),
+					(uint8_t)(acc >> 8),
+					(uint8_t)acc,
+					config.burst - 1, NO_TRIGGER, 1);
+				if(bit_is_clear(STOP_REG, STOP_BIT)) running = false; // the burst is done
+			}
+			else {
+				phase = signalOut(signalBuffer,
+					(uint8_t)(acc >> 24),
+					(uint8_t)(acc >> 16),
+					(uint8_t)(acc >> 8),
+					(uint8_t)acc);
+				finish = PHASE_CONTROL && config.finishPeriod;
+			}
+			break;
+		case SyncOut_Multiple:
+			signalWithSyncOut(signalBuffer,
 				(uint8_t)(acc >> 24),
 				(uint8_t)(acc >> 16),
 				(uint8_t)(acc >> 8),
 				(uint8_t)acc);
 			break;
-		case SyncOut_Multiple:
-			signalWithSyncOut(signalBuffer,
+		case SyncOut_Trigger: {
+				uint32_t count   = triggerDelayCount();
+				uint32_t holdoff = delayMsToCount(config.triggerHoldoff);
+				uint8_t high;
+				if(!burst) {
+					if(armTrigger(holdoff, &high)) {
+						triggeredSignalOut(signalBuffer,
+							(uint8_t)(acc >> 24),
+							(uint8_t)(acc >> 16),
+							(uint8_t)(acc >> 8),
+							(uint8_t)acc,
+							high, count);
+					}
+					break;
+				}
+
+				// re-arm in place, the buttons are checked only when the generation is interrupted
+				while(armTrigger(holdoff, &high)) {
+					burstOut(signalBuffer,
+						(uint8_t)(acc >> 24),
+						(uint8_t)(acc >> 16),
+						(uint8_t)(acc >> 8),
+						(uint8_t)acc,
+						config.burst - 1, high, count);
+					R2RPORT = config.offLevel;
+
+					if(bit_is_set(STOP_REG, STOP_BIT)) break;
+					if(!config.burstRearm) {
+						running = false; // one burst per start
+						break;
+					}
+				}
+			}
+			break;
+#if TRIGGER_MODES
+		case SyncOut_Gate:
+			gatedSignalOut(signalBuffer,
 				(uint8_t)(acc >> 24),
 				(uint8_t)(acc >> 16),
 				(uint8_t)(acc >> 8),
-				(uint8_t)acc);
+				(uint8_t)acc,
+				config.offLevel, config.gateHold);
+			break;
+#endif
+#if MODULATION
+		case SyncOut_Phase:
+		case SyncOut_Toggle: {
+				uint8_t hsLow  = HSPORT & ~_BV(HS);
+				uint8_t hsHigh = HSPORT |  _BV(HS);
+				if(config.syncOut == SyncOut_Phase)
+					signalWithPhaseSync(signalBuffer,
+						(uint8_t)(acc >> 24),
+						(uint8_t)(acc >> 16),
+						(uint8_t)(acc >> 8),
+						(uint8_t)acc,
+						config.syncDuty, hsHigh, hsLow);
+				else
+					signalWithToggleSync(signalBuffer,
+						(uint8_t)(acc >> 24),
+						(uint8_t)(acc >> 16),
+						(uint8_t)(acc >> 8),
+						(uint8_t)acc,
+						hsLow, _BV(HS));
+				HSPORT = hsLow;
+			}
+			break;
+		case SyncOut_Fsk: {
+				uint32_t accHigh = freqToAcc(config.fskFreq, FSK_OUT_TICKS);
+				fskSignalOut(signalBuffer, acc, accHigh);
+			}
 			break;
-		case SyncOut_Trigger:
-			if(waitTrigger()) {
-				signalOut(signalBuffer,
+		case SyncOut_Psk:
+			pskSignalOut(signalBuffer,
+				(uint8_t)(acc >> 24),
+				(uint8_t)(acc >> 16),
+				(uint8_t)(acc >> 8),
+				(uint8_t)acc,
+				config.pskPhase);
+			break;
+#endif
+#if TIMER1_MODES
+		case SyncOut_Clock:
+		case SyncOut_Pwm:
+			if(config.hsLock) {
+				// Timer1 is restarted on the same cycle as the DDS after each interruption
+				lockedSignalOut(signalBuffer,
 					(uint8_t)(acc >> 24),
 					(uint8_t)(acc >> 16),
 					(uint8_t)(acc >> 8),
-					(uint8_t)acc);
+					(uint8_t)acc,
+					SFIOR | (1 << PSR10), dual_prepareTimer());
+				break;
 			}
+
+			// free running Timer1 is started once
+			if((TCCR1B & 0x07) == 0) TCCR1B = dual_prepareTimer();
+			phase = signalOut(signalBuffer,
+				(uint8_t)(acc >> 24),
+				(uint8_t)(acc >> 16),
+				(uint8_t)(acc >> 8),
+				(uint8_t)acc);
+			finish = PHASE_CONTROL && config.finishPeriod;
 			break;
-		case SyncOut_End: break;
+#endif
+		default: break;
 	}
 
-	R2RPORT = config.offLevel;
+	if(!finish) R2RPORT = config.offLevel;   // otherwise the output holds the sample until it is known
+	rotateBuffer(-rotation);
 
 	// generation is interrupted - check buttons
 	signal_recheckButtons();
-}
 
-void signal_run(void) {
-	memcpy_P(signalBuffer, (const uint8_t *)menuEntry.data, sizeof(signalBuffer));
-	while(running) {
-		signal_continue(true);
+	// a stop, not a change while running: the rest of the period from the phase it stopped at;
+	// another stop, START (any button) or remote command ends it at once
+	if(finish && !running) {
+		rotateBuffer(rotation);
+		STOP_REG &= ~(1 << STOP_BIT);
+		finishOut(signalBuffer, phase,
+			(uint8_t)(acc >> 24),
+			(uint8_t)(acc >> 16),
+			(uint8_t)(acc >> 8),
+			(uint8_t)acc);
+		rotateBuffer(-rotation);
 	}
+	R2RPORT = config.offLevel;
 }
 
-void signal_stop(void) {
-	enableMenu();
-	running = false;
-	R2RPORT = config.offLevel;
-	menuEntry.updateDisplay();
+uint8_t waveNibble(const uint8_t *data, uint16_t n) {
+	uint8_t b = pgm_read_byte(data + n / 2);
+	return (n & 1) ? (b & 0x0f) : (b >> 4);
+}
+
+// expands a table of waves.h into signalBuffer rotated left by rotation samples, see wavegen.c for the formats;
+// 0.2 ms for the raw and the quarter wave tables, about 0.6 ms for the delta ones
+void expandWave(const uint8_t *wave, uint8_t rotation) {
+	uint8_t format = pgm_read_byte(wave++);
+	uint8_t i = 0;
+	switch(format) {
+		case WAVE_RAW:
+			do {
+				signalBuffer[(uint8_t)(i - rotation)] = pgm_read_byte(wave + i);
+			} while(++i != 0);
+			break;
+
+		case WAVE_QUARTER: {
+			rotation += pgm_read_byte(wave++);
+			uint8_t sum = pgm_read_byte(wave++);
+			do {
+				uint8_t v = pgm_read_byte(wave + ((i <= SIGNAL_BUFFER_SIZE / 4) ? i : SIGNAL_BUFFER_SIZE / 2 - i));
+				signalBuffer[(uint8_t)(i - rotation)] = v;
+				signalBuffer[(uint8_t)(i + SIGNAL_BUFFER_SIZE / 2 - rotation)] = sum - v;
+			} while(++i != SIGNAL_BUFFER_SIZE / 2);
+			break;
+		}
+
+		case WAVE_DELTA: {
+			uint8_t v = pgm_read_byte(wave++);
+			uint16_t n = 0;
+			for(;;) {
+				signalBuffer[(uint8_t)(i - rotation)] = v;
+				if(++i == 0) break;
+				uint8_t d = waveNibble(wave, n++);
+				if(d == 8) {
+					v = (waveNibble(wave, n) << 4) | waveNibble(wave, n + 1);
+					n += 2;
+				}
+				else {
+					v += (int8_t)(d << 4) >> 4;
+				}
+			}
+			break;
+		}
+	}
+}
+
+#if SYNTH
+// sine of index/256 of the period from the quarter table
+int16_t quarterSine(uint8_t index) {
+	uint8_t k = index & 63;
+	if(index & 64) k = 64 - k;
+	int16_t s = pgm_read_word(&QUARTER_SINE[k]);
+	return (index & 128) ? -s : s;
+}
+
+// fills signalBuffer from the shape parameters, the start phase is applied by signal_continue();
+// 16-bit phase: 0..0x7fff - rising part (shapeSymmetry samples), 0x8000..0xffff - falling part
+void shape_fill(void) {
+	if(config.shapeType == ShapeType_Pulse) {
+		for(uint16_t i = 0; i < sizeof(signalBuffer); ++i)
+			signalBuffer[i] = (i < config.shapeDuty) ? 0xff : 0x00;
+		return;
+	}
+
+	uint8_t rise = config.shapeSymmetry;
+	uint32_t inc = 0x800000ul / rise;   // phase increment of the rising part, 8 fractional bits
+	uint32_t phase = 0;
+	for(uint16_t i = 0; i < sizeof(signalBuffer); ++i) {
+		if(i == rise) {
+			phase = 0x800000ul;
+			inc = 0x800000ul / (sizeof(signalBuffer) - rise);
+		}
+		uint16_t p = phase >> 8;
+		if(config.shapeType == ShapeType_Triangle) {
+			signalBuffer[i] = (p < 0x8000) ? (p >> 7) : ((uint16_t)~p >> 7);
+		}
+		else {
+			// sine from the minimum (index -90 deg), linear interpolation between the quarter table samples
+			uint8_t index = (p >> 8) + 192;
+			int32_t a = quarterSine(index);
+			int32_t b = quarterSine(index + 1);
+			signalBuffer[i] = (uint16_t)(a + (((b - a) * (uint8_t)p) >> 8) + 32768) >> 8;
+		}
+		phase += inc;
+	}
+}
+
+// sum of the harmonics at the sample i, each term is scaled down by 256 to fit 32 bits with the normalization
+int32_t harmonics_sample(uint8_t i) {
+	int32_t sum = 0;
+	for(uint8_t h = 0; h < HARMONICS; ++h) {
+		if(config.harmAmp[h] != 0)
+			sum += ((int32_t)config.harmAmp[h] * quarterSine((uint8_t)((h + 1) * i + config.harmPhase[h]))) >> 8;
+	}
+	return sum;
+}
+
+// fills signalBuffer with the harmonic spectrum; two passes: the peaks, then the samples scaled to 0..255
+void harmonics_fill(void) {
+	int32_t min = INT32_MAX, max = INT32_MIN;
+	uint16_t i;
+	for(i = 0; i < sizeof(signalBuffer); ++i) {
+		int32_t s = harmonics_sample(i);
+		if(s < min) min = s;
+		if(s > max) max = s;
+	}
+
+	uint32_t range = max - min;
+	for(i = 0; i < sizeof(signalBuffer); ++i) {
+		if(range == 0)
+			signalBuffer[i] = 0x80;
+		else
+			signalBuffer[i] = ((uint32_t)(harmonics_sample(i) - min) * 255 + range / 2) / range;
+	}
+}
+#endif
+
+void signal_run(void) {
+#if SYNTH
+	if(menuEntry.data == NULL)
+		shape_fill();
+	else
+#endif
+		expandWave((const uint8_t *)menuEntry.data, 0);
+	while(running) {
+		signal_continue(true);
+	}
+}
+
+void signal_stop(void) {
+	enableMenu();
+	running = false;
+	R2RPORT = config.offLevel;
+	if(isDualOutput()) {
+		timer1Stop();
+		HSPORT &= ~(1 << HS);   // set HS pin to LOW
+	}
+	menuEntry.updateDisplay();
 	while(buttonState.pressed != Button_None); // wait until button release, otherwise the generation will be started again
 }
 
@@ -1055,6 +2460,174 @@ void signal_onStart(void) {
 	}
 }
 
+#if REMOTE
+bool arb_isRunning(void) {
+	return running && menuEntry.buttonHandlers.onStart == arb_onStart;
+}
+
+// loads the EEPROM slot into signalBuffer; not while another mode is using the buffer
+bool arb_load(uint8_t slot) {
+	if(slot >= ARB_SLOTS || (running && !arb_isRunning())) return false;
+	eeprom_read_block(signalBuffer, (const void *)EE_ARB(slot), SIGNAL_BUFFER_SIZE);
+	arbSlot   = slot;
+	arbLoaded = true;
+	return true;
+}
+
+// stores the uploaded samples, 0.9 s for the whole slot (the output pauses if running)
+bool arb_save(uint8_t slot) {
+	if(slot >= ARB_SLOTS || !arbLoaded) return false;
+	eeprom_update_block(signalBuffer, (void *)EE_ARB(slot), SIGNAL_BUFFER_SIZE);
+	arbSlot = slot;
+	return true;
+}
+
+void arb_onStart(void) {
+	if(!running) {
+		bool loaded = arbLoaded;
+		signal_start();
+		if(loaded)
+			arbLoaded = true;
+		else if(!arb_load(arbSlot))
+			memset(signalBuffer, config.offLevel, SIGNAL_BUFFER_SIZE);   // no EEPROM slot
+		while(running) {
+			signal_continue(true);
+		}
+		signal_stop();
+	}
+	else {
+		running = false;
+	}
+}
+#endif
+
+#if SYNTH
+void shape_updateDisplay(void) {
+	LCDGotoXY(6, 0);
+	switch(config.shapeType) {
+		case ShapeType_Sine:     print_P(PSTR("Sine %5.1f%%"), config.shapeSymmetry * 100.0 / 256); break;
+		case ShapeType_Triangle: print_P(PSTR("Tri  %5.1f%%"), config.shapeSymmetry * 100.0 / 256); break;
+		case ShapeType_Pulse:    print_P(PSTR("Puls %5.1f%%"), config.shapeDuty * 100.0 / 256);     break;
+		case ShapeType_End:                                                                  break;
+	}
+	signal_updateDisplay();
+}
+
+void harmonics_onStart(void) {
+	if(!running) {
+		signal_start();
+		harmonics_fill();
+		while(running) {
+			signal_continue(true);
+		}
+		signal_stop();
+	}
+	else {
+		running = false;
+	}
+}
+
+void harmonic_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("H%-2u %5.1f%% %3u"), harmonic + 1, config.harmAmp[harmonic] / 10.0,
+		(uint16_t)(config.harmPhase[harmonic] * 360ul / 256));
+}
+
+void harmonic_onLeft(void) {
+	if(harmonic > 0) --harmonic;
+	harmonic_updateDisplay();
+}
+
+void harmonic_onRight(void) {
+	if(harmonic < HARMONICS - 1) ++harmonic;
+	harmonic_updateDisplay();
+}
+
+void harmAmp_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("H%-2u %5.1f%%"), harmonic + 1, config.harmAmp[harmonic] / 10.0);
+}
+
+void harmAmp_onLeft(void) {
+	if(config.harmAmp[harmonic] > 0) --config.harmAmp[harmonic];
+	harmAmp_updateDisplay();
+}
+
+void harmAmp_onRight(void) {
+	if(config.harmAmp[harmonic] < MAX_HARM_AMP) ++config.harmAmp[harmonic];
+	harmAmp_updateDisplay();
+}
+
+void harmPhase_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("H%-2u %5.1fdeg"), harmonic + 1, config.harmPhase[harmonic] * 360.0 / 256);
+}
+
+void harmPhase_onLeft(void) {
+	--config.harmPhase[harmonic];
+	harmPhase_updateDisplay();
+}
+
+void harmPhase_onRight(void) {
+	++config.harmPhase[harmonic];
+	harmPhase_updateDisplay();
+}
+
+void shapeType_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	switch(config.shapeType) {
+		case ShapeType_Sine:     print_P(PSTR("Sine    ")); break;
+		case ShapeType_Triangle: print_P(PSTR("Triangle")); break;
+		case ShapeType_Pulse:    print_P(PSTR("Pulse   ")); break;
+		case ShapeType_End:                       ; break;
+	}
+}
+
+void shapeType_onLeft(void) {
+	if(config.shapeType != ShapeType_Sine) {
+		config.shapeType = (enum ShapeType)((uint8_t)config.shapeType - 1);
+		shapeType_updateDisplay();
+	}
+}
+
+void shapeType_onRight(void) {
+	if(config.shapeType != ShapeType_End - 1) {
+		config.shapeType = (enum ShapeType)((uint8_t)config.shapeType + 1);
+		shapeType_updateDisplay();
+	}
+}
+
+void shapeSymmetry_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1f%%"), config.shapeSymmetry * 100.0 / 256);
+}
+
+void shapeSymmetry_onLeft(void) {
+	if(config.shapeSymmetry > 1) --config.shapeSymmetry;
+	shapeSymmetry_updateDisplay();
+}
+
+void shapeSymmetry_onRight(void) {
+	if(config.shapeSymmetry < 255) ++config.shapeSymmetry;
+	shapeSymmetry_updateDisplay();
+}
+
+void shapeDuty_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1f%%"), config.shapeDuty * 100.0 / 256);
+}
+
+void shapeDuty_onLeft(void) {
+	if(config.shapeDuty > 1) --config.shapeDuty;
+	shapeDuty_updateDisplay();
+}
+
+void shapeDuty_onRight(void) {
+	if(config.shapeDuty < 255) ++config.shapeDuty;
+	shapeDuty_updateDisplay();
+}
+#endif
+
 void noise_updateDisplay(void) {
 	LCDGotoXY(0, 1);
 	CopyStringtoLCD(RND, 0, 1);
@@ -1063,9 +2636,9 @@ void noise_updateDisplay(void) {
 
 void noise_onStart(void) {
 	signal_start();
-	SPCR &= ~(1<<CPHA); // clear CPHA bit in SPCR register to allow DDS
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
 
-	memcpy_P(signalBuffer, NOISE_SIGNAL, sizeof(signalBuffer));
+	expandWave(NOISE_SIGNAL, 0);
 
 	if(config.syncOut == SyncOut_Single || config.syncOut == SyncOut_Multiple) 
 		syncPulse();
@@ -1077,16 +2650,22 @@ void noise_onStart(void) {
 	signal_stop();
 }
 
+// pulse length in CPU cycles, as it will be generated
+uint32_t pulseTicks(void) {
+	uint32_t ticks = msToTicks(config.pulse);
+	return (ticks < PULSE_MIN_TICKS) ? PULSE_MIN_TICKS : ticks;
+}
+
 void pulse_updateDisplay(void) {
 	LCDGotoXY(0, 1);
 	if(config.pulse == -INFINITY)
-		printf("until rel ");
+		print_P(PSTR("until rel    "));
 	else if(config.pulse == 0.0)
-		printf("min       ");
+		print_P(PSTR("min          "));
 	else if(config.pulse == INFINITY)
-		printf("until stop");
+		print_P(PSTR("until stop   "));
 	else
-		printf("%8.3fms", config.pulse);
+		print_P(PSTR("%11.6fms"), (double)pulseTicks() / (CPU_FREQ / 1000));
 
 	displaySignalStatus();
 }
@@ -1129,12 +2708,41 @@ void pulse_onRight(void) {
 	}
 }
 
+// one pulse with the exact (1 cycle) length and trigger delay;
+// the HS edges follow the R2R edges with 1 cycle
+void pulse_run(bool hsOut) {
+	uint32_t width = pulseTicks() - 4;
+	uint32_t delay = msToTicks(config.triggerDelay);
+	delay = (delay >= PULSE_TRIGGER_TICKS + 5) ? delay - PULSE_TRIGGER_TICKS : 5;
+	uint32_t holdoff = delayMsToCount(config.triggerHoldoff);
+
+	disableMenu();
+	STOP_REG &= ~(1 << STOP_BIT);
+
+	uint8_t high = NO_TRIGGER;
+	if(config.syncOut != SyncOut_Trigger || armTrigger(holdoff, &high)) {
+		uint8_t hsLow  = hsOut ? (HSPORT & ~_BV(HS)) : HSPORT;
+		uint8_t hsHigh = hsOut ? (HSPORT |  _BV(HS)) : HSPORT;
+		pulseOut(high,
+			delay / 5, delay % 5,
+			width / 5, width % 5,
+			0xFF, config.offLevel,
+			hsHigh, hsLow);
+	}
+
+	enableMenu();
+	while(buttonState.pressed != Button_None); // wait until button release, otherwise the pulse will be started again
+}
+
 void pulse_onStart(void) {
 	if(!running) {
 		running = true;
 		pulse_updateDisplay();
 		bool hsOut = isHsOutputEnabled();
-		if(waitTrigger()) {
+		if(config.pulse != -INFINITY && config.pulse != 0.0 && config.pulse != INFINITY) {
+			pulse_run(hsOut);
+		}
+		else if(waitTrigger()) {
 			if(config.pulse == -INFINITY) {
 				if(hsOut) HSPORT |=  (1 << HS);
 				R2RPORT = 0xFF;
@@ -1161,14 +2769,6 @@ void pulse_onStart(void) {
 				}
 				R2RPORT = config.offLevel;
 			}
-			else {
-				uint32_t count = delayMsToCount(config.pulse);
-				R2RPORT = 0xFF;
-				if(hsOut) HSPORT |=  (1 << HS);
-				delayCount(count);
-				if(hsOut) HSPORT &= ~(1 << HS);
-				R2RPORT = config.offLevel;
-			}
 		}
 		running = false;
 		pulse_updateDisplay();
@@ -1180,7 +2780,7 @@ void pulse_onStart(void) {
 
 void freqStep_updateDisplay(void) {
 	LCDGotoXY(0, 1);
-	printf("%10.3fHz", config.freqStep);
+	print_P(PSTR("%10.3fHz"), config.freqStep);
 }
 
 void freqStep_onLeft(void) {
@@ -1200,8 +2800,8 @@ void freqStep_onRight(void) {
 void freqMode_updateDisplay(void) {
 	LCDGotoXY(0, 1);
 	switch(config.freqMode) {
-		case FreqMode_Exact:    printf("Exact      "); break; 
-		case FreqMode_Jitter:   printf("Min. jitter"); break;
+		case FreqMode_Exact:    print_P(PSTR("Exact      ")); break; 
+		case FreqMode_Jitter:   print_P(PSTR("Min. jitter")); break;
 	}
 }
 
@@ -1224,7 +2824,7 @@ void displayHsOutputStatus(void) {
 
 void hs_updateDisplay(void) {
 	LCDGotoXY(0, 1);
-	printf(" %5uMHz", config.hsFreq);
+	print_P(PSTR(" %5uMHz"), config.hsFreq);
 	displayHsOutputStatus();
 }
 
@@ -1257,6 +2857,14 @@ void hs_onStart(void) {
 		running = true;
 		menuEntry.updateDisplay();
 
+#if TIMER1_MODES
+		if(config.hsBurst != 0) {
+			uint16_t ocr;
+			uint8_t cs = timer1FindCtc((double)config.hsFreq * 1000000, &ocr);
+			hsBurst_run(cs, ocr);
+			running = false;
+		}
+#endif
 		hs_restart();
 		while(running) {
 			processButton();
@@ -1268,14 +2876,96 @@ void hs_onStart(void) {
 	}
 }
 
+#if TIMER1_MODES
+// shows the achieved frequency and its error in ppm
+void hsClock_updateDisplay(void) {
+	uint16_t ocr;
+	uint8_t cs = timer1FindCtc(config.hsClock, &ocr);
+	double freq = timer1CtcFreq(cs, ocr);
+
+	// 8 characters are left on the line: ppm up to +-9999, percents above
+	double ppm = (freq - config.hsClock) / config.hsClock * 1e6;
+	LCDGotoXY(8, 0);
+	if(fabs(ppm) < 9999.5)
+		print_P(PSTR("%+5.0fppm"), ppm);
+	else
+		print_P(PSTR("%+7.2f%%"), ppm / 1e4);
+	showFreq(freq);
+	displayHsOutputStatus();
+}
+
+void hsClock_restart(void) {
+	if(running) {
+		uint16_t ocr;
+		uint8_t cs = timer1FindCtc(config.hsClock, &ocr);
+		timer1StartCtc(cs, ocr);
+	}
+}
+
+void hsClock_onLeft(void) {
+	config.hsClock -= config.freqStep;
+	if(config.hsClock < MIN_HS_CLOCK)
+		config.hsClock = MIN_HS_CLOCK;
+	hsClock_updateDisplay();
+	hsClock_restart();
+}
+
+void hsClock_onRight(void) {
+	config.hsClock += config.freqStep;
+	if(config.hsClock > MAX_HS_CLOCK)
+		config.hsClock = MAX_HS_CLOCK;
+	hsClock_updateDisplay();
+	hsClock_restart();
+}
+
+void hsClock_onStart(void) {
+	if(running) {
+		running = false;
+	}
+	else if(isHsOutputEnabled()) {
+		saveSettings();
+		running = true;
+		menuEntry.updateDisplay();
+
+		if(config.hsBurst != 0) {
+			uint16_t ocr;
+			uint8_t cs = timer1FindCtc(config.hsClock, &ocr);
+			hsBurst_run(cs, ocr);
+			running = false;
+		}
+		else {
+			hsClock_restart();
+			while(running) {
+				processButton();
+			}
+		}
+
+		timer1Stop();
+		HSPORT &= ~(1 << HS);   // set HS pin to LOW
+		menuEntry.updateDisplay();
+	}
+}
+#endif
+
 void pwm_displayDuty(void) {
 	LCDGotoXY(10, 0);
-	printf("%5.1f%%", ((double)config.pwmDuty+1) / 256 * 100);
+	print_P(PSTR("%5.1f%%"), ((double)config.pwmDuty+1) / 256 * 100);
+}
+
+// the compare mode has no sync output except the single pulse
+bool pwm_isFine(void) {
+	return PHASE_CONTROL && config.pwmFine && (config.syncOut == SyncOut_Off || config.syncOut == SyncOut_Single);
 }
 
 void pwm_updateDisplay(void) {
 	signal_updateDisplay();
-	pwm_displayDuty();
+	if(pwm_isFine()) {
+		LCDGotoXY(4, 0);
+		print_P(PSTR("PWM %7.3f%%"), (double)config.pwmFineDuty / 65536 * 100);
+	}
+	else {
+		pwm_displayDuty();
+	}
 }
 
 void pwn_prepareBuffer(void) {
@@ -1285,9 +2975,45 @@ void pwn_prepareBuffer(void) {
 	}
 }
 
+#if PHASE_CONTROL
+// output is high while the upper 16 bits of the phase are below the duty,
+// so the edge moves between samples from period to period and the average duty has 1/65536 resolution
+void pwm_continueFine(void) {
+	uint32_t acc = freqToAcc(config.freq, PWM_COMPARE_TICKS);
+	if(acc == 0) acc = 1;
+
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
+	if(config.syncOut == SyncOut_Single) syncPulse();
+
+	pwmCompareOut(
+		(uint8_t)(acc >> 24),
+		(uint8_t)(acc >> 16),
+		(uint8_t)(acc >> 8),
+		(uint8_t)acc,
+		(uint8_t)(config.pwmFineDuty >> 8),
+		(uint8_t)config.pwmFineDuty);
+	R2RPORT = config.offLevel;
+
+	// generation is interrupted - check buttons
+	signal_recheckButtons();
+}
+#endif
+
 void pwm_run(void) {
+	int16_t duty = -1; // the buffer is not prepared yet
 	while(running) {
-		pwn_prepareBuffer();
+#if PHASE_CONTROL
+		if(pwm_isFine()) {
+			pwm_continueFine();
+			continue;
+		}
+#endif
+
+		// rebuild the table only when the duty is changed
+		if(duty != config.pwmDuty) {
+			pwn_prepareBuffer();
+			duty = config.pwmDuty;
+		}
 		signal_continue(true);
 	}
 }
@@ -1307,6 +3033,11 @@ void pwm_onUp(void) {
 	if(!running) {
 		menu_onUp();
 	}
+	else if(pwm_isFine()) {
+		uint16_t step = countStep();
+		config.pwmFineDuty = (config.pwmFineDuty > UINT16_MAX - step) ? UINT16_MAX : config.pwmFineDuty + step;
+		pwm_updateDisplay();
+	}
 	else {
 		if(config.pwmDuty < 255) ++config.pwmDuty;
 		pwm_updateDisplay();
@@ -1317,6 +3048,11 @@ void pwm_onDown(void) {
 	if(!running) {
 		menu_onDown();
 	}
+	else if(pwm_isFine()) {
+		uint16_t step = countStep();
+		config.pwmFineDuty = (config.pwmFineDuty < step) ? 0 : config.pwmFineDuty - step;
+		pwm_updateDisplay();
+	}
 	else {
 		if(config.pwmDuty > 0) --config.pwmDuty;
 		pwm_updateDisplay();
@@ -1335,7 +3071,7 @@ void pwmHs_updateDisplay(void) {
 
 	pwm_displayDuty();
 	LCDGotoXY(0, 1);
-	printf("%8.2fHz", freq);
+	print_P(PSTR("%8.2fHz"), freq);
 	displayHsOutputStatus();
 }
 
@@ -1404,66 +3140,474 @@ void pwmHs_onRight(void) {
 	pwmHs_updateDisplay();
 }
 
-void sweep_updateDisplay(void) {
-	switch(submenuLevel) {
-		case 0:
-			CopyStringtoLCD(SWEEP_TITLE, 0, 0);
-			LCDGotoXY(0, 1);
-			printf("%10.3fHz", config.freq);
-			break;
+#if TIMER1_MODES
+// OCR1A for the duty; in the fast mode the output is high for OCR1A + 1 of TOP + 1 ticks,
+// in the phase correct mode for OCR1A of TOP
+uint16_t pwmHr_ocr(uint16_t top) {
+	double ocr = config.pwmPhaseCorrect
+		? config.pwmHrDuty * top
+		: config.pwmHrDuty * ((uint32_t)top + 1) - 1;
+	if(ocr < 0.0) return 0;
+	if(ocr > top) return top;
+	return (uint16_t)(ocr + 0.5);
+}
 
-		case 1:
-			CopyStringtoLCD(SWEEP_END_TITLE, 0, 0);
-			LCDGotoXY(0, 1);
-			printf("%10.3fHz", config.freqEnd);
-			break;
+// shows the mode, resolution (bits) and duty in the first line, the achieved frequency in the second one
+void pwmHr_updateDisplay(void) {
+	uint16_t top;
+	uint8_t cs = timer1FindPwm(config.pwmHrFreq, config.pwmPhaseCorrect, &top);
+	uint16_t ocr = pwmHr_ocr(top);
 
-		case 2:
-			CopyStringtoLCD(SWEEP_INC_TITLE, 0, 0);
-			LCDGotoXY(0, 1);
-			printf("%10.3fHz", config.freqInc);
-			break;
+	uint8_t bits = 0;
+	for(uint32_t t = (uint32_t)top + 1; t > 1; t >>= 1) ++bits;
+
+	double duty = config.pwmPhaseCorrect
+		? (double)ocr / top
+		: ((double)ocr + 1) / ((uint32_t)top + 1);
+
+	LCDGotoXY(4, 0);
+	print_P(PSTR("%c%2ub%7.3f%%"), config.pwmPhaseCorrect ? 'P' : 'F', bits, duty * 100);
+	showFreq(timer1PwmFreq(cs, top, config.pwmPhaseCorrect));
+	displayHsOutputStatus();
+}
 
+void pwmHr_restart(void) {
+	if(running) {
+		uint16_t top;
+		uint8_t cs = timer1FindPwm(config.pwmHrFreq, config.pwmPhaseCorrect, &top);
+		timer1StartPwmIcr(cs, top, pwmHr_ocr(top), config.pwmPhaseCorrect);
 	}
-	displaySignalStatus();
 }
 
-void sweep_onUp(void) {
-	submenuLevel = 0;
-	menu_onUp();
+// the duty step is countStep() ticks of the current TOP
+void pwmHr_changeDuty(int8_t dir) {
+	uint16_t top;
+	timer1FindPwm(config.pwmHrFreq, config.pwmPhaseCorrect, &top);
+	config.pwmHrDuty += (double)dir * countStep() / ((uint32_t)top + 1);
+	if(config.pwmHrDuty < 0.0) config.pwmHrDuty = 0.0;
+	if(config.pwmHrDuty > 1.0) config.pwmHrDuty = 1.0;
+	OCR1A = pwmHr_ocr(top);
+	pwmHr_updateDisplay();
 }
 
-void sweep_onDown(void) {
-	submenuLevel = 0;
-	menu_onDown();
+void pwmHr_onUp(void) {
+	if(!running) {
+		menu_onUp();
+	}
+	else {
+		pwmHr_changeDuty(1);
+	}
 }
 
-void sweep_onLeft(void) {
-	switch(submenuLevel) {
-		case 0:
-			config.freq -= config.freqStep;
-			if(config.freq < MIN_FREQ)
-				config.freq = MIN_FREQ;
-			break;
+void pwmHr_onDown(void) {
+	if(!running) {
+		menu_onDown();
+	}
+	else {
+		pwmHr_changeDuty(-1);
+	}
+}
 
-		case 1:
-			config.freqEnd -= config.freqStep;
-			if(config.freqEnd < config.freq)
-				config.freqEnd = config.freq;
-			break;
+void pwmHr_onLeft(void) {
+	config.pwmHrFreq -= config.freqStep;
+	if(config.pwmHrFreq < MIN_PWM_FREQ)
+		config.pwmHrFreq = MIN_PWM_FREQ;
+	pwmHr_updateDisplay();
+	pwmHr_restart();
+}
 
-		case 2:
-			config.freqInc -= config.freqStep;
-			if(config.freqInc < MIN_FREQ_INC)
-				config.freqInc = MIN_FREQ_INC;
-			break;
-	}
-	sweep_updateDisplay();
+void pwmHr_onRight(void) {
+	config.pwmHrFreq += config.freqStep;
+	if(config.pwmHrFreq > MAX_PWM_FREQ)
+		config.pwmHrFreq = MAX_PWM_FREQ;
+	pwmHr_updateDisplay();
+	pwmHr_restart();
 }
 
-void sweep_onRight(void) {
-	switch(submenuLevel) {
-		case 0:
+void pwmHr_onStart(void) {
+	if(running) {
+		running = false;
+	}
+	else if(isHsOutputEnabled()) {
+		saveSettings();
+		running = true;
+		menuEntry.updateDisplay();
+
+		pwmHr_restart();
+		while(running) {
+			processButton();
+		}
+
+		timer1Stop();
+		HSPORT &= ~(1 << HS);   // set HS pin to LOW
+		menuEntry.updateDisplay();
+	}
+}
+
+void pwmMode_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.pwmPhaseCorrect)
+		print_P(PSTR("Phase Correct"));
+	else
+		print_P(PSTR("Fast         "));
+}
+
+// sets Timer1 up for the dual output with the clock stopped; returns TCCR1B value which starts it
+uint8_t dual_prepareTimer(void) {
+	TCCR1B = 0;
+	TCCR1A = (1 << COM1A1) | (1 << FOC1A); // force OC1A low, so the clock starts with the same level
+
+	if(config.syncOut == SyncOut_Clock) {
+		uint16_t ocr;
+		uint8_t cs = timer1FindCtc(config.hsClock, &ocr);
+		return timer1SetupCtc(cs, ocr);
+	}
+
+	uint16_t top;
+	uint8_t cs = timer1FindPwm(config.pwmHrFreq, config.pwmPhaseCorrect, &top);
+	return timer1SetupPwmIcr(cs, top, pwmHr_ocr(top), config.pwmPhaseCorrect);
+}
+
+// Emits config.hsBurst cycles of the CTC clock on HS, the output starts and ends low.
+// Long half-periods are counted by the compare interrupt; short ones by a cycle-counted delay
+// with the interrupts disabled, which stops the timer a quarter of the period (rounded up, so at least
+// one cycle at 8 MHz) after the last falling edge.
+void hsBurst_run(uint8_t cs, uint16_t ocr) {
+	uint32_t half = (uint32_t)pgm_read_word(&TIMER1_DIVS[cs - 1]) * ((uint32_t)ocr + 1); // cycles
+
+	disableMenu();
+#if REMOTE
+	remoteHold = true;
+#endif
+	STOP_REG &= ~(1 << STOP_BIT);
+
+	TCCR1B = 0;
+	TCCR1A = (1 << COM1A1) | (1 << FOC1A); // force OC1A low
+	uint8_t tccr = timer1SetupCtc(cs, ocr);
+
+	if(half >= HS_BURST_ISR_TICKS) {
+		hsTogglesLeft = 2 * (uint32_t)config.hsBurst;
+		TIFR  = (1 << OCF1A);
+		TIMSK |= (1 << OCIE1A);
+		SFIOR |= (1 << PSR10);
+		TCCR1B = tccr;
+		while(TCCR1B != 0 && bit_is_clear(STOP_REG, STOP_BIT)); // stopped by the interrupt or by a button
+		TIMSK &= ~(1 << OCIE1A);
+	}
+	else {
+		// cycles from the timer start to the stop
+		uint32_t ticks = 2 * half * config.hsBurst + (half + 1) / 2;
+		if(ticks < 3) ticks = 3;
+		if(ticks <= 10)
+			hsBurstOut(true, 0, ticks - 3, SFIOR | (1 << PSR10), tccr);
+		else
+			hsBurstOut(false, (ticks - 2) / 6, (ticks - 2) % 6, SFIOR | (1 << PSR10), tccr);
+	}
+
+	timer1Stop();
+	HSPORT &= ~(1 << HS);   // set HS pin to LOW
+#if REMOTE
+	remoteHold = false;     // the queued commands run in the main loop
+#endif
+	enableMenu();
+	while(buttonState.pressed != Button_None); // wait until button release, otherwise the burst will be started again
+}
+#endif
+
+#if COUNTER
+// the same format as showFreq: us below 1 s, ms above
+void showTime(double seconds) {
+	LCDGotoXY(0, 1);
+	if(seconds < 1.0)
+		print_P(PSTR("%10.3fus"), seconds * 1e6);
+	else
+		print_P(PSTR("%10.3fms"), seconds * 1e3);
+}
+
+void counter_updateDisplay(void) {
+	LCDGotoXY(8, 0);
+	switch(config.counterMode) {
+		case CounterMode_Freq:   print_P(PSTR("Freq    ")); showFreq(counterValue); break;
+		case CounterMode_Period: print_P(PSTR("Period  ")); showTime(counterValue); break;
+		case CounterMode_Width:  print_P(PSTR("Width   ")); showTime(counterValue); break;
+		case CounterMode_End:                                               break;
+	}
+	CopyStringtoLCD(running ? MNON : MNOFF, 13, 1);
+}
+
+void counter_onLeft(void) {
+	if(!running && config.counterMode != CounterMode_Freq) {
+		config.counterMode = (enum CounterMode)((uint8_t)config.counterMode - 1);
+		counterValue = 0.0;
+		counter_updateDisplay();
+	}
+}
+
+void counter_onRight(void) {
+	if(!running && config.counterMode != CounterMode_End - 1) {
+		config.counterMode = (enum CounterMode)((uint8_t)config.counterMode + 1);
+		counterValue = 0.0;
+		counter_updateDisplay();
+	}
+}
+
+// counts the T1 edges during the gate time made by Timer0 (1 ms interrupts);
+// returns false if interrupted
+bool counter_measureFreq(void) {
+	CNTDDR  &= ~_BV(CNT_T1);
+	CNTPORT &= ~_BV(CNT_T1);
+
+	t1Overflows = 0;
+	gateMsLeft  = config.counterGate;
+	TCCR1A = 0;
+	TCNT1  = 0;
+	TCNT0  = 0;
+	OCR0   = CPU_FREQ / 64 / 1000 - 1;
+	TIFR   = (1 << TOV1) | (1 << OCF0);
+	TIMSK |= (1 << TOIE1) | (1 << OCIE0);
+	TCCR1B = (1 << CS12) | (1 << CS11) | (1 << CS10);    // external clock on T1, rising edge
+	TCCR0  = (1 << WGM01) | (1 << CS01) | (1 << CS00);   // CTC, prescaller 64
+
+	while(TCCR1B != 0 && bit_is_clear(STOP_REG, STOP_BIT));
+
+	TCCR0  = 0;
+	TIMSK &= ~((1 << TOIE1) | (1 << OCIE0));
+	if(TCCR1B != 0) {
+		TCCR1B = 0;
+		return false;
+	}
+
+	uint32_t count = ((uint32_t)t1Overflows << 16) | TCNT1;
+	if(bit_is_set(TIFR, TOV1)) count += (uint32_t)1 << 16;
+	counterValue = count / (config.counterGate / 1000.0 * config.freqCal);
+	return true;
+}
+
+// Timer1 captures the analog comparator output: AIN1 (PB3) against the bandgap reference (~1.23 V);
+// returns false if interrupted, otherwise captureSum has the ticks of n periods or of n pulses
+bool counter_capture(uint16_t n, bool width) {
+	CNTDDR  &= ~_BV(CNT_AIN);
+	CNTPORT &= ~_BV(CNT_AIN);
+	ACSR = (1 << ACBG) | (1 << ACIC);
+
+	t1Overflows  = 0;
+	captureSum   = 0;
+	capturesLeft = n;
+	captureStarted = false;
+	captureWidth = width;
+	TCCR1A = 0;
+	TCNT1  = 0;
+	TCCR1B = (1 << CS10);       // the falling edge of the comparator output, no prescaller
+	TIFR   = (1 << TOV1) | (1 << ICF1);
+	TIMSK |= (1 << TOIE1) | (1 << TICIE1);
+
+	while(capturesLeft != 0 && bit_is_clear(STOP_REG, STOP_BIT));
+
+	TIMSK &= ~((1 << TOIE1) | (1 << TICIE1));
+	TCCR1B = 0;
+	ACSR   = 0;
+	return capturesLeft == 0;
+}
+
+// the period or the pulse width averaged over config.counterAvg events; returns false if interrupted
+bool counter_measureCapture(void) {
+	if(!counter_capture(config.counterAvg, config.counterMode == CounterMode_Width)) return false;
+
+	counterValue = (double)captureSum / config.counterAvg / CPU_FREQ * config.freqCal;
+	return true;
+}
+
+void counter_onStart(void) {
+	if(!running) {
+		signal_start();
+		while(running) {
+			STOP_REG &= ~(1 << STOP_BIT);
+#if REMOTE
+			remoteHold = true;
+#endif
+			bool done = (config.counterMode == CounterMode_Freq) ? counter_measureFreq() : counter_measureCapture();
+#if REMOTE
+			remoteHold = false;
+#endif
+			if(done)
+				counter_updateDisplay();
+			if(!done || REMOTE)   // the commands received during the gate
+				signal_recheckButtons();
+		}
+		signal_stop();
+	}
+	else {
+		running = false;
+	}
+}
+
+void counterGate_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5ums"), config.counterGate);
+}
+
+void counterGate_onLeft(void) {
+	uint16_t step = countStep();
+	config.counterGate = (config.counterGate > step) ? config.counterGate - step : 1;
+	counterGate_updateDisplay();
+}
+
+void counterGate_onRight(void) {
+	uint16_t step = countStep();
+	config.counterGate = (config.counterGate < MAX_COUNTER_GATE - step) ? config.counterGate + step : MAX_COUNTER_GATE;
+	counterGate_updateDisplay();
+}
+
+void counterAvg_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5u"), config.counterAvg);
+}
+
+void counterAvg_onLeft(void) {
+	uint16_t step = countStep();
+	config.counterAvg = (config.counterAvg > step) ? config.counterAvg - step : 1;
+	counterAvg_updateDisplay();
+}
+
+void counterAvg_onRight(void) {
+	uint16_t step = countStep();
+	config.counterAvg = (config.counterAvg < MAX_BURST - step) ? config.counterAvg + step : MAX_BURST;
+	counterAvg_updateDisplay();
+}
+#endif
+
+#if TIMER1_MODES
+void hsBurst_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.hsBurst == 0)
+		print_P(PSTR("Continuous"));
+	else
+		print_P(PSTR("%5u     "), config.hsBurst);
+}
+
+void hsBurst_onLeft(void) {
+	uint16_t step = countStep();
+	config.hsBurst = (config.hsBurst > step) ? config.hsBurst - step : 0;
+	hsBurst_updateDisplay();
+}
+
+void hsBurst_onRight(void) {
+	uint16_t step = countStep();
+	config.hsBurst = (config.hsBurst < MAX_BURST - step) ? config.hsBurst + step : MAX_BURST;
+	hsBurst_updateDisplay();
+}
+
+void hsLock_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.hsLock)
+		print_P(PSTR("On "));
+	else
+		print_P(PSTR("Off"));
+}
+
+void hsLock_onLeft(void) {
+	config.hsLock = false;
+	hsLock_updateDisplay();
+}
+
+void hsLock_onRight(void) {
+	config.hsLock = true;
+	hsLock_updateDisplay();
+}
+#endif
+
+#if PHASE_CONTROL
+void pwmFine_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.pwmFine)
+		print_P(PSTR("16-bit Compare"));
+	else
+		print_P(PSTR("8-bit Table   "));
+}
+
+void pwmFine_onLeft(void) {
+	config.pwmFine = false;
+	pwmFine_updateDisplay();
+}
+
+void pwmFine_onRight(void) {
+	config.pwmFine = true;
+	pwmFine_updateDisplay();
+}
+#endif
+
+#if TIMER1_MODES
+void pwmMode_onLeft(void) {
+	config.pwmPhaseCorrect = false;
+	pwmMode_updateDisplay();
+}
+
+void pwmMode_onRight(void) {
+	config.pwmPhaseCorrect = true;
+	pwmMode_updateDisplay();
+}
+#endif
+
+void sweep_updateDisplay(void) {
+	switch(submenuLevel) {
+		case 0:
+			CopyStringtoLCD(SWEEP_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.3fHz"), config.freq);
+			break;
+
+		case 1:
+			CopyStringtoLCD(SWEEP_END_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.3fHz"), config.freqEnd);
+			break;
+
+		case 2:
+			CopyStringtoLCD(SWEEP_INC_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.3fHz"), config.freqInc);
+			break;
+
+	}
+	displaySignalStatus();
+}
+
+void sweep_onUp(void) {
+	submenuLevel = 0;
+	menu_onUp();
+}
+
+void sweep_onDown(void) {
+	submenuLevel = 0;
+	menu_onDown();
+}
+
+void sweep_onLeft(void) {
+	switch(submenuLevel) {
+		case 0:
+			config.freq -= config.freqStep;
+			if(config.freq < MIN_FREQ)
+				config.freq = MIN_FREQ;
+			break;
+
+		case 1:
+			config.freqEnd -= config.freqStep;
+			if(config.freqEnd < config.freq)
+				config.freqEnd = config.freq;
+			break;
+
+		case 2:
+			config.freqInc -= config.freqStep;
+			if(config.freqInc < MIN_FREQ_INC)
+				config.freqInc = MIN_FREQ_INC;
+			break;
+	}
+	sweep_updateDisplay();
+}
+
+void sweep_onRight(void) {
+	switch(submenuLevel) {
+		case 0:
 			config.freq += config.freqStep;
 			if(config.freq > MAX_FREQ)
 				config.freq = MAX_FREQ;
@@ -1505,7 +3649,7 @@ void sweep_continue(void) {
 	uint8_t startIndex = sizeof(signalBuffer) / 2; // here should be the maximum
 	while((startIndex < sizeof(signalBuffer)-1) && (signalBuffer[startIndex] > config.offLevel)) ++startIndex;
 
-	SPCR &= ~(1<<CPHA); // clear CPHA bit in SPCR register to allow DDS
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
 
 	if(config.syncOut == SyncOut_Single || config.syncOut == SyncOut_Multiple) 
 		syncPulse();
@@ -1554,7 +3698,7 @@ void sweep_onStart(void) {
 					menuEntry.updateDisplay();
 					disableMenu();
 
-					memcpy_P(signalBuffer, SINE_WAVE_FROM_ZERO, sizeof(signalBuffer));
+					expandWave(SINE_WAVE, SIGNAL_BUFFER_SIZE * 3 / 4);   // sine from the minimum
 					while(running) {
 						sweep_continue();
 					}
@@ -1573,94 +3717,751 @@ void sweep_onStart(void) {
 	}
 }
 
-void offLevel_updateDisplay(void) {
-	LCDGotoXY(0, 1);
-	printf("%3u", config.offLevel);
-}
+#if TIMER1_MODES
+void train_updateDisplay(void) {
+	switch(submenuLevel) {
+		case 0:
+			CopyStringtoLCD(TRAIN_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.5fms"), config.trainPeriod);
+			break;
 
-void offLevel_onLeft(void) {
-	if(config.offLevel > 0) --config.offLevel;
-	R2RPORT = config.offLevel;
-	offLevel_updateDisplay();
-}
+		case 1:
+			CopyStringtoLCD(TRAIN_WIDTH_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.5fms"), config.trainWidth);
+			break;
 
-void offLevel_onRight(void) {
-	if(config.offLevel < 255) ++config.offLevel;
-	R2RPORT = config.offLevel;
-	offLevel_updateDisplay();
-}
+		case 2:
+			CopyStringtoLCD(TRAIN_COUNT_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			if(config.trainCount == 0)
+				print_P(PSTR("Infinite    "));
+			else
+				print_P(PSTR("%5u       "), config.trainCount);
+			break;
 
-void syncOut_updateDisplay(void) {
-	LCDGotoXY(0, 1);
-	switch(config.syncOut) {
-		case SyncOut_Off:      printf("Off     "); break; 
-		case SyncOut_Single:   printf("Single  "); break;
-		case SyncOut_Multiple: printf("Multiple"); break;
-		case SyncOut_Trigger:  printf("Trigger "); break;
-		case SyncOut_End:                        ; break; 
+		case 3:
+			CopyStringtoLCD(TRAIN_DELAY_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("%10.5fms"), config.trainDelay);
+			break;
 	}
+	displayHsOutputStatus();
 }
+#endif
 
-void syncOut_onLeft(void) {
-	if(config.syncOut != SyncOut_Off)
-		config.syncOut = (enum SyncOut)((uint8_t)config.syncOut - 1);
-	syncOut_updateDisplay();
-}
-
-void syncOut_onRight(void) {
-	config.syncOut = (enum SyncOut)((uint8_t)config.syncOut + 1);
-	if(config.syncOut == SyncOut_End) config.syncOut = (enum SyncOut)((uint8_t)SyncOut_End - 1);
-	syncOut_updateDisplay();
-}
+#if MODULATION
+void dualTone_updateDisplay(void) {
+	switch(submenuLevel) {
+		case 0:
+			CopyStringtoLCD(DUAL_TONE_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(PSTR("DTMF %c    "), pgm_read_byte(&DTMF_DIGITS[config.dtmfDigit]));
+			break;
 
-void syncOut_onOpt(void) {
-	setHsDirection(); // commit selection
-	optMenu_onOpt();
-}
+		case 1:
+			CopyStringtoLCD(TONE1_TITLE, 0, 0);
+			showFreq(config.toneFreq1);
+			break;
 
-void trigger_updateDisplay(void) {
-	LCDGotoXY(0, 1);
-	if(config.syncOut == SyncOut_Trigger)
-		printf("%8.3fms", config.triggerDelay);
-	else
-		printf("Off       ");
+		case 2:
+			CopyStringtoLCD(TONE2_TITLE, 0, 0);
+			showFreq(config.toneFreq2);
+			break;
+	}
+	displaySignalStatus();
 }
 
-void trigger_onLeft(void) {
-	config.syncOut = SyncOut_Trigger;
-	config.triggerDelay -= config.freqStep / 100;
-	if(config.triggerDelay < MIN_PULSE)
-		config.triggerDelay = 0.0;
-	trigger_updateDisplay();
+void dualTone_onUp(void) {
+	submenuLevel = 0;
+	menu_onUp();
 }
 
-void trigger_onRight(void) {
-	config.syncOut = SyncOut_Trigger;
-	config.triggerDelay += config.freqStep / 100;
-	if(config.triggerDelay > MAX_PULSE)
-		config.triggerDelay = MAX_PULSE;
-	trigger_updateDisplay();
+void dualTone_onDown(void) {
+	submenuLevel = 0;
+	menu_onDown();
 }
 
-void calFreq_updateDisplay(void) {
-	LCDGotoXY(0, 1);
-	printf("%8.6f", config.freqCal);
-	displaySignalStatus();
+void dualTone_setDigit(uint8_t digit) {
+	config.dtmfDigit = digit;
+	config.toneFreq1 = pgm_read_word(&DTMF_LOW[digit / 4]);
+	config.toneFreq2 = pgm_read_word(&DTMF_HIGH[digit % 4]);
 }
 
-void calFreq_onStart(void) {
-	if(!running) {
-		running = true;
-		calFreq_updateDisplay();
-		disableMenu();
+void dualTone_onLeft(void) {
+	switch(submenuLevel) {
+		case 0:
+			if(config.dtmfDigit > 0) dualTone_setDigit(config.dtmfDigit - 1);
+			break;
 
-		memcpy_P(signalBuffer, SINE_WAVE_FROM_ZERO, sizeof(signalBuffer));
-		while(running) {
-			signal_continue(false);
-		}
+		case 1:
+			config.toneFreq1 -= config.freqStep;
+			if(config.toneFreq1 < MIN_FREQ)
+				config.toneFreq1 = MIN_FREQ;
+			break;
 
-		enableMenu();
-		running = false;
+		case 2:
+			config.toneFreq2 -= config.freqStep;
+			if(config.toneFreq2 < MIN_FREQ)
+				config.toneFreq2 = MIN_FREQ;
+			break;
+	}
+	dualTone_updateDisplay();
+}
+
+void dualTone_onRight(void) {
+	switch(submenuLevel) {
+		case 0:
+			if(config.dtmfDigit < sizeof(DTMF_DIGITS) - 2) dualTone_setDigit(config.dtmfDigit + 1);
+			break;
+
+		case 1:
+			config.toneFreq1 += config.freqStep;
+			if(config.toneFreq1 > MAX_FREQ)
+				config.toneFreq1 = MAX_FREQ;
+			break;
+
+		case 2:
+			config.toneFreq2 += config.freqStep;
+			if(config.toneFreq2 > MAX_FREQ)
+				config.toneFreq2 = MAX_FREQ;
+			break;
+	}
+	dualTone_updateDisplay();
+}
+
+// 24-bit accumulators: the upper 24 bits of the usual 32-bit phase increment
+void dualTone_continue(void) {
+	uint32_t acc1 = freqToAcc(config.toneFreq1, DUAL_TONE_TICKS) >> 8;
+	uint32_t acc2 = freqToAcc(config.toneFreq2, DUAL_TONE_TICKS) >> 8;
+
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
+
+	if(config.syncOut == SyncOut_Single || config.syncOut == SyncOut_Multiple)
+		syncPulse();
+
+	if(waitTrigger()) {
+		dualToneOut(signalBuffer,
+			(uint8_t)(acc1 >> 16),
+			(uint8_t)(acc1 >> 8),
+			(uint8_t)acc1,
+			(uint8_t)(acc2 >> 16),
+			(uint8_t)(acc2 >> 8),
+			(uint8_t)acc2);
+	}
+	R2RPORT = config.offLevel;
+
+	// generation is interrupted - check buttons
+	signal_recheckButtons();
+}
+
+void dualTone_onStart(void) {
+	if(!running) {
+		if(submenuLevel < 2) {
+			++submenuLevel;
+			dualTone_updateDisplay();
+		}
+		else {
+			signal_start();
+
+			// half amplitude sine, so the sum of two samples fits the DAC
+			expandWave(SINE_HALF_WAVE, 0);
+
+			while(running) {
+				dualTone_continue();
+			}
+			signal_stop();
+		}
+	}
+	else {
+		running = false;
+	}
+}
+#endif
+
+#if RECORD_PLAYBACK
+void record_updateDisplay(void) {
+	switch(submenuLevel) {
+		case 0: {
+			struct Record record;
+			memcpy_P(&record, &RECORDS[config.recordNum], sizeof(record));
+			CopyStringtoLCD(RECORD_TITLE, 0, 0);
+			CopyStringtoLCD(record.name, 0, 1);
+			break;
+		}
+
+		case 1:
+			CopyStringtoLCD(RECORD_MODE_TITLE, 0, 0);
+			LCDGotoXY(0, 1);
+			print_P(config.recordLoop ? PSTR("Loop         ") : PSTR("One-shot     "));
+			break;
+
+		case 2:
+			CopyStringtoLCD(RECORD_RATE_TITLE, 0, 0);
+			showFreq(config.recordRate);
+			break;
+	}
+	displaySignalStatus();
+}
+
+void record_onUp(void) {
+	submenuLevel = 0;
+	menu_onUp();
+}
+
+void record_onDown(void) {
+	submenuLevel = 0;
+	menu_onDown();
+}
+
+// a new record starts at its recorded rate
+void record_select(uint8_t num) {
+	config.recordNum  = num;
+	config.recordRate = pgm_read_word(&RECORDS[num].rate);
+}
+
+void record_onLeft(void) {
+	switch(submenuLevel) {
+		case 0:
+			if(config.recordNum > 0) record_select(config.recordNum - 1);
+			break;
+
+		case 1:
+			config.recordLoop = false;
+			break;
+
+		case 2:
+			config.recordRate -= config.freqStep;
+			if(config.recordRate < MIN_FREQ)
+				config.recordRate = MIN_FREQ;
+			break;
+	}
+	record_updateDisplay();
+}
+
+void record_onRight(void) {
+	switch(submenuLevel) {
+		case 0:
+			if(config.recordNum < RECORDS_SIZE - 1) record_select(config.recordNum + 1);
+			break;
+
+		case 1:
+			config.recordLoop = true;
+			break;
+
+		case 2:
+			config.recordRate += config.freqStep;
+			if(config.recordRate > MAX_RECORD_RATE)
+				config.recordRate = MAX_RECORD_RATE;
+			break;
+	}
+	record_updateDisplay();
+}
+
+// the playback position survives the button checks, the rate may change on the fly
+const uint8_t *recordPosition;
+uint32_t recordFraction;
+
+void record_continue(const uint8_t *data, uint16_t size) {
+	double resolution = (double)CPU_FREQ / RECORD_TICKS / ((uint32_t)1 << 24);
+	uint32_t inc = config.recordRate / (resolution / config.freqCal);   // 8.24 samples per tick
+
+	STOP_REG &= ~(1 << STOP_BIT); // clear the stop flag to allow DDS
+
+	if(config.syncOut == SyncOut_Single || config.syncOut == SyncOut_Multiple)
+		syncPulse();
+
+	if(waitTrigger()) {
+		recordOut(&recordPosition, &recordFraction, inc, data + size, size, config.recordLoop);
+	}
+	R2RPORT = config.offLevel;
+
+	if(recordPosition >= data + size) {   // one-shot is over
+		running = false;
+		return;
+	}
+
+	// generation is interrupted - check buttons
+	signal_recheckButtons();
+}
+
+void record_onStart(void) {
+	if(!running) {
+		if(submenuLevel < 2) {
+			++submenuLevel;
+			record_updateDisplay();
+		}
+		else {
+			struct Record record;
+			memcpy_P(&record, &RECORDS[config.recordNum], sizeof(record));
+
+			signal_start();
+			recordPosition = record.data;
+			recordFraction = 0;
+			while(running) {
+				record_continue(record.data, record.size);
+			}
+			signal_stop();
+		}
+	}
+	else {
+		running = false;
+	}
+}
+#endif
+
+#if TIMER1_MODES
+void train_onUp(void) {
+	submenuLevel = 0;
+	menu_onUp();
+}
+
+void train_onDown(void) {
+	submenuLevel = 0;
+	menu_onDown();
+}
+
+void train_onLeft(void) {
+	uint16_t step = countStep();
+	switch(submenuLevel) {
+		case 0:
+			config.trainPeriod -= config.freqStep / 100;
+			if(config.trainPeriod < MIN_TRAIN_PERIOD)
+				config.trainPeriod = MIN_TRAIN_PERIOD;
+			if(config.trainWidth > config.trainPeriod)
+				config.trainWidth = config.trainPeriod;
+			break;
+
+		case 1:
+			config.trainWidth -= config.freqStep / 100;
+			if(config.trainWidth < 0.0)
+				config.trainWidth = 0.0;
+			break;
+
+		case 2:
+			config.trainCount = (config.trainCount > step) ? config.trainCount - step : 0;
+			break;
+
+		case 3:
+			config.trainDelay -= config.freqStep / 100;
+			if(config.trainDelay < 0.0)
+				config.trainDelay = 0.0;
+			break;
+	}
+	train_updateDisplay();
+}
+
+void train_onRight(void) {
+	uint16_t step = countStep();
+	switch(submenuLevel) {
+		case 0:
+			config.trainPeriod += config.freqStep / 100;
+			if(config.trainPeriod > MAX_TRAIN_PERIOD)
+				config.trainPeriod = MAX_TRAIN_PERIOD;
+			break;
+
+		case 1:
+			config.trainWidth += config.freqStep / 100;
+			if(config.trainWidth > config.trainPeriod)
+				config.trainWidth = config.trainPeriod;
+			break;
+
+		case 2:
+			config.trainCount = (config.trainCount < MAX_BURST - step) ? config.trainCount + step : MAX_BURST;
+			break;
+
+		case 3:
+			config.trainDelay += config.freqStep / 100;
+			if(config.trainDelay > MAX_PULSE)
+				config.trainDelay = MAX_PULSE;
+			break;
+	}
+	train_updateDisplay();
+}
+
+// Timer1 generates the train on OC1A (HS) in the inverting Fast PWM mode:
+// the low phase is at the begin of each period, the pulse is at the end
+void train_run(void) {
+	uint32_t period = msToTicks(config.trainPeriod);
+	uint32_t width  = msToTicks(config.trainWidth);
+	uint32_t delay  = msToTicks(config.trainDelay);
+
+	uint16_t div;
+	uint8_t cs = timer1Prescaler(period, &div);
+
+	uint16_t top = period / div - 1;
+	uint16_t w = width / div;
+	if(w == 0)   w = 1;
+	if(w >= top) w = top - 1;  // keep at least one tick low
+	uint16_t ocr = top - w;
+
+	// the first pulse starts when TCNT1 reaches OCR1A, the rest of the delay is made by software
+	uint16_t tcnt = 0;
+	uint32_t preDelay = 0;
+	if(delay / div <= ocr)
+		tcnt = ocr - delay / div;
+	else
+		preDelay = (delay - (uint32_t)ocr * div) / 6;
+
+	// the period where TCNT1 starts after OCR1B has no compare B interrupt
+	pulsesLeft = config.trainCount;
+	if(tcnt >= ocr / 2) --pulsesLeft;
+
+	STOP_REG &= ~(1 << STOP_BIT);
+
+	if(preDelay != 0) delayCount(preDelay);
+	// compare B is armed before the timer starts, so none is missed at a short prescaler
+	if(config.trainCount != 0) {
+		TIFR  = (1 << OCF1B);
+		TIMSK |= (1 << OCIE1B);
+	}
+	timer1StartPulseTrain(cs, top, ocr, tcnt);
+	if(config.trainCount != 0 && pulsesLeft == 0) OCR1A = top; // single pulse, buffered until BOTTOM
+
+	mirrorHsOut(0xFF, config.offLevel);
+
+	TIMSK &= ~(1 << OCIE1B);
+	timer1Stop();
+	HSPORT &= ~(1 << HS);   // set HS pin to LOW
+}
+
+void train_onStart(void) {
+	if(!running) {
+		if(submenuLevel < 3) {
+			++submenuLevel;
+			train_updateDisplay();
+		}
+		else if(isHsOutputEnabled()) {
+			saveSettings();
+			running = true;
+			menuEntry.updateDisplay();
+			disableMenu();
+
+			train_run();
+
+			signal_stop();
+
+			// reset menu
+			submenuLevel = 0;
+			onNewMenuEntry();
+		}
+	}
+	else {
+		running = false;
+	}
+}
+#endif
+
+void offLevel_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%3u"), config.offLevel);
+}
+
+void offLevel_onLeft(void) {
+	if(config.offLevel > 0) --config.offLevel;
+	R2RPORT = config.offLevel;
+	offLevel_updateDisplay();
+}
+
+void offLevel_onRight(void) {
+	if(config.offLevel < 255) ++config.offLevel;
+	R2RPORT = config.offLevel;
+	offLevel_updateDisplay();
+}
+
+void syncOut_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	switch(config.syncOut) {
+		case SyncOut_Off:      print_P(PSTR("Off     ")); break; 
+		case SyncOut_Single:   print_P(PSTR("Single  ")); break;
+		case SyncOut_Multiple: print_P(PSTR("Multiple")); break;
+		case SyncOut_Trigger:  print_P(PSTR("Trigger ")); break;
+#if TRIGGER_MODES
+		case SyncOut_Gate:     print_P(PSTR("Gate    ")); break;
+#endif
+#if TIMER1_MODES
+		case SyncOut_Clock:    print_P(PSTR("Clock   ")); break;
+		case SyncOut_Pwm:      print_P(PSTR("PWM     ")); break;
+#endif
+#if MODULATION
+		case SyncOut_Phase:    print_P(PSTR("Phase   ")); break;
+		case SyncOut_Toggle:   print_P(PSTR("Toggle  ")); break;
+		case SyncOut_Fsk:      print_P(PSTR("FSK     ")); break;
+		case SyncOut_Psk:      print_P(PSTR("PSK     ")); break;
+#endif
+		default:                                ; break; 
+	}
+}
+
+#if MODULATION
+void syncPhase_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1fdeg"), config.syncPhase * 360.0 / 256);
+}
+
+void syncPhase_onLeft(void) {
+	--config.syncPhase;
+	syncPhase_updateDisplay();
+}
+
+void syncPhase_onRight(void) {
+	++config.syncPhase;
+	syncPhase_updateDisplay();
+}
+
+void syncDuty_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1f%%"), config.syncDuty * 100.0 / 256);
+}
+
+void syncDuty_onLeft(void) {
+	if(config.syncDuty > 1) --config.syncDuty;
+	syncDuty_updateDisplay();
+}
+
+void syncDuty_onRight(void) {
+	if(config.syncDuty < 255) ++config.syncDuty;
+	syncDuty_updateDisplay();
+}
+
+void fskFreq_updateDisplay(void) {
+	showFreq(config.fskFreq);
+}
+
+void fskFreq_onLeft(void) {
+	config.fskFreq -= config.freqStep;
+	if(config.fskFreq < MIN_FREQ)
+		config.fskFreq = MIN_FREQ;
+	fskFreq_updateDisplay();
+}
+
+void fskFreq_onRight(void) {
+	config.fskFreq += config.freqStep;
+	if(config.fskFreq > MAX_FREQ)
+		config.fskFreq = MAX_FREQ;
+	fskFreq_updateDisplay();
+}
+
+void pskPhase_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1fdeg"), config.pskPhase * 360.0 / 256);
+}
+
+void pskPhase_onLeft(void) {
+	--config.pskPhase;
+	pskPhase_updateDisplay();
+}
+
+void pskPhase_onRight(void) {
+	++config.pskPhase;
+	pskPhase_updateDisplay();
+}
+#endif
+
+#if PHASE_CONTROL
+void startPhase_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5.1fdeg"), config.startPhase * 360.0 / 256);
+}
+
+void startPhase_onLeft(void) {
+	--config.startPhase;
+	startPhase_updateDisplay();
+}
+
+void startPhase_onRight(void) {
+	++config.startPhase;
+	startPhase_updateDisplay();
+}
+
+void stopMode_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.finishPeriod)
+		print_P(PSTR("End of Period"));
+	else
+		print_P(PSTR("At Once      "));
+}
+
+void stopMode_onLeft(void) {
+	config.finishPeriod = false;
+	stopMode_updateDisplay();
+}
+
+void stopMode_onRight(void) {
+	config.finishPeriod = true;
+	stopMode_updateDisplay();
+}
+#endif
+
+// the values of the options not built in are skipped
+void syncOut_onLeft(void) {
+	uint8_t syncOut = config.syncOut;
+	if(syncOut != SyncOut_Off) {
+		do --syncOut; while(!isSyncOutAvailable(syncOut));
+		config.syncOut = (enum SyncOut)syncOut;
+	}
+	syncOut_updateDisplay();
+}
+
+void syncOut_onRight(void) {
+	uint8_t syncOut = config.syncOut;
+	do ++syncOut; while(syncOut < SyncOut_End && !isSyncOutAvailable(syncOut));
+	if(syncOut < SyncOut_End) config.syncOut = (enum SyncOut)syncOut;
+	syncOut_updateDisplay();
+}
+
+void syncOut_onOpt(void) {
+	setHsDirection(); // commit selection
+	optMenu_onOpt();
+}
+
+void trigger_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.syncOut == SyncOut_Trigger)
+		print_P(PSTR("%8.3fms"), config.triggerDelay);
+	else
+		print_P(PSTR("Off       "));
+}
+
+void trigger_onLeft(void) {
+	config.syncOut = SyncOut_Trigger;
+	config.triggerDelay -= config.freqStep / 100;
+	if(config.triggerDelay < MIN_PULSE)
+		config.triggerDelay = 0.0;
+	trigger_updateDisplay();
+}
+
+void trigger_onRight(void) {
+	config.syncOut = SyncOut_Trigger;
+	config.triggerDelay += config.freqStep / 100;
+	if(config.triggerDelay > MAX_PULSE)
+		config.triggerDelay = MAX_PULSE;
+	trigger_updateDisplay();
+}
+
+#if TRIGGER_MODES
+void triggerEdge_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	switch(config.triggerEdge) {
+		case TriggerEdge_High:    print_P(PSTR("High level")); break;
+		case TriggerEdge_Rising:  print_P(PSTR("Rising    ")); break;
+		case TriggerEdge_Falling: print_P(PSTR("Falling   ")); break;
+		case TriggerEdge_Both:    print_P(PSTR("Both      ")); break;
+		case TriggerEdge_End:                        ; break;
+	}
+}
+
+void triggerEdge_onLeft(void) {
+	if(config.triggerEdge != TriggerEdge_High)
+		config.triggerEdge = (enum TriggerEdge)((uint8_t)config.triggerEdge - 1);
+	triggerEdge_updateDisplay();
+}
+
+void triggerEdge_onRight(void) {
+	config.triggerEdge = (enum TriggerEdge)((uint8_t)config.triggerEdge + 1);
+	if(config.triggerEdge == TriggerEdge_End) config.triggerEdge = (enum TriggerEdge)((uint8_t)TriggerEdge_End - 1);
+	triggerEdge_updateDisplay();
+}
+
+void holdoff_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%8.3fms"), config.triggerHoldoff);
+}
+
+void holdoff_onLeft(void) {
+	config.triggerHoldoff -= config.freqStep / 100;
+	if(config.triggerHoldoff < MIN_PULSE)
+		config.triggerHoldoff = 0.0;
+	holdoff_updateDisplay();
+}
+
+void holdoff_onRight(void) {
+	config.triggerHoldoff += config.freqStep / 100;
+	if(config.triggerHoldoff > MAX_PULSE)
+		config.triggerHoldoff = MAX_PULSE;
+	holdoff_updateDisplay();
+}
+
+void burst_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.burst == 0)
+		print_P(PSTR("Continuous"));
+	else
+		print_P(PSTR("%5u     "), config.burst);
+}
+
+void burst_onLeft(void) {
+	uint16_t step = countStep();
+	config.burst = (config.burst > step) ? config.burst - step : 0;
+	burst_updateDisplay();
+}
+
+void burst_onRight(void) {
+	uint16_t step = countStep();
+	config.burst = (config.burst < MAX_BURST - step) ? config.burst + step : MAX_BURST;
+	burst_updateDisplay();
+}
+
+void burstRearm_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.burstRearm)
+		print_P(PSTR("Each trigger"));
+	else
+		print_P(PSTR("Once        "));
+}
+
+void burstRearm_onLeft(void) {
+	config.burstRearm = false;
+	burstRearm_updateDisplay();
+}
+
+void burstRearm_onRight(void) {
+	config.burstRearm = true;
+	burstRearm_updateDisplay();
+}
+
+void gateHold_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(config.gateHold)
+		print_P(PSTR("Hold     "));
+	else
+		print_P(PSTR("Off Level"));
+}
+
+void gateHold_onLeft(void) {
+	config.gateHold = false;
+	gateHold_updateDisplay();
+}
+
+void gateHold_onRight(void) {
+	config.gateHold = true;
+	gateHold_updateDisplay();
+}
+#endif
+
+void calFreq_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%8.6f"), config.freqCal);
+	displaySignalStatus();
+}
+
+void calFreq_onStart(void) {
+	if(!running) {
+		running = true;
+		calFreq_updateDisplay();
+		disableMenu();
+#if REMOTE
+		arbLoaded = false;
+#endif
+
+		expandWave(SINE_WAVE, SIGNAL_BUFFER_SIZE * 3 / 4);   // sine from the minimum
+		while(running) {
+			signal_continue(false);
+		}
+
+		enableMenu();
+		running = false;
 		R2RPORT = config.offLevel;
 		calFreq_updateDisplay();
 		while(buttonState.pressed != Button_None); // wait until button release, otherwise the generation will be started again
@@ -1670,6 +4471,51 @@ void calFreq_onStart(void) {
 	}
 }
 
+#if COUNTER
+void autoCal_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5uHz %8.6f "), pgm_read_word(&CAL_REFS[config.calRef]), config.freqCal);
+}
+
+void autoCal_onLeft(void) {
+	if(config.calRef != 0) --config.calRef;
+	autoCal_updateDisplay();
+}
+
+void autoCal_onRight(void) {
+	if(config.calRef < sizeof(CAL_REFS) / sizeof(CAL_REFS[0]) - 1) ++config.calRef;
+	autoCal_updateDisplay();
+}
+
+// measures the reference on the capture input (AIN1) over the counter gate time:
+// n periods of the reference take n / ref seconds, i.e. CPU_FREQ / freqCal * n / ref ticks
+void autoCal_onStart(void) {
+	uint16_t ref = pgm_read_word(&CAL_REFS[config.calRef]);
+	uint32_t n = (uint32_t)ref * config.counterGate / 1000;
+	if(n == 0)         n = 1;
+	if(n > MAX_BURST)  n = MAX_BURST;
+
+	LCDGotoXY(8, 1);
+	print_P(PSTR("  wait  "));
+	running = true;
+	disableMenu();
+	STOP_REG &= ~(1 << STOP_BIT);
+
+	if(counter_capture(n, false)) {
+		double freqCal = (double)CPU_FREQ * n / ref / captureSum;
+		if(freqCal >= MIN_FREQ_CAL && freqCal <= MAX_FREQ_CAL) {
+			config.freqCal = freqCal;
+			saveSettings();
+		}
+	}
+
+	enableMenu();
+	running = false;
+	autoCal_updateDisplay();
+	while(buttonState.pressed != Button_None); // wait until button release, otherwise the calibration will be started again
+}
+#endif
+
 void calFreq_onLeft(void) {
 	config.freqCal -= STEP_FREQ_CAL;
 	if(config.freqCal < MIN_FREQ_CAL)
@@ -1696,32 +4542,308 @@ ISR(TIMER2_OVF_vect)
 Original idea is taken from
 http://www.myplace.nu/avr/minidds/index.htm
 small modification is made - added additional command which
-checks if CPHA bit is set in SPCR register if yes - exit function
+checks if the stop flag (STOP_BIT in STOP_REG) is set if yes - exit function;
+returns the phase it stopped at (the index in the upper byte) for finishOut()
 */
-inline void static signalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0)
+inline uint32_t static signalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0)
+{
+	uint8_t p0, p1, p2;
+	asm volatile(
+		"eor %[p0], %[p0] 		; p0<-0"			"\n\t"
+		"eor %[p1], %[p1] 		; p1<-0"			"\n\t"
+		"eor %[p2], %[p2] 		; p2<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add %[p0], %[ad0]		; 1 cycle"			"\n\t"
+		"adc %[p1], %[ad1]		; 1 cycle"			"\n\t"
+		"adc %[p2], %[ad2]		; 1 cycle"			"\n\t"	
+		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 10 cycles"	"\n\t"
+		: [p0] "=&r"(p0), [p1] "=&r"(p1), [p2] "=&r"(p2),           // phase fraction
+		  [sig] "+z"(signal)                                              // signal source, the index
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+	);
+	return ((uint32_t)(uint8_t)(uintptr_t)signal << 24) | ((uint32_t)p2 << 16) | ((uint16_t)p1 << 8) | p0;
+}
+
+// the rest of the period after signalOut() stopped at the phase, at the same 10 cycles per sample:
+// ends when the index wraps (the sample of index 0 is not output) or at once when the stop flag is set
+inline void static finishOut(const uint8_t *signal, uint32_t phase, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0)
+{
+	uint8_t p0 = phase, p1 = phase >> 8, p2 = phase >> 16;
+	signal += (uint8_t)(phase >> 24);   // the buffer is aligned, the low byte is the index
+	asm volatile(
+		"rjmp 2f			; the sample of the phase is out"	"\n\t"
+		"1:"								"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"2:"								"\n\t"
+		"add %[p0], %[ad0]		; 1 cycle"			"\n\t"
+		"adc %[p1], %[ad1]		; 1 cycle"			"\n\t"
+		"adc %[p2], %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle, C on wrap"		"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"brcc 1b			; 2 cycles. Total 10 cycles"	"\n\t"
+		: [p0] "+r"(p0), [p1] "+r"(p1), [p2] "+r"(p2),              // phase fraction
+		  [sig] "+z"(signal)                                              // signal source, the index
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+	);
+}
+
+// signalOut() which starts Timer1 first: the prescaler is reset and TCCR1B is written on the next cycle,
+// the first sample is output 7 cycles after the timer start
+inline void static lockedSignalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                                   uint8_t psr, uint8_t tccr)
 {
 	asm volatile(
 		"eor r17, r17 			; r17<-0"			"\n\t"
 		"eor r18, r18 			; r18<-0"			"\n\t"
 		"eor r19, r19 			; r19<-0"			"\n\t"
+		"out %[sfior], %[psr]		; reset the prescaler"		"\n\t"
+		"out %[tccr1b], %[tccr]		; start Timer1"			"\n\t"
 		"1:"								"\n\t"
 		"add r17, %[ad0]		; 1 cycle"			"\n\t"
 		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
-		"adc r19, %[ad2]		; 1 cycle"			"\n\t"	
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
 		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
 		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
 		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
-		"sbis %[cond], 2		; 1 cycle if no skip" 		"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
 		"rjmp 1b			; 2 cycles. Total 10 cycles"	"\n\t"
-		:
+		: [sig] "+z"(signal)                                              // signal source
 		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
-		  [sig] "z"(signal),                                              // signal source
+		  [psr] "r"(psr), [tccr] "r"(tccr),                               // timer start
+		  [sfior] "I"(_SFR_IO_ADDR(SFIOR)), [tccr1b] "I"(_SFR_IO_ADDR(TCCR1B)),
 		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
-		  [cond] "I"(_SFR_IO_ADDR(SPCR))                                  // exit condition
-		: "r17", "r18", "r19" 
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// HS is high while the table index is below the duty; both paths are 14 cycles
+// and write HS on the same cycle
+inline void static signalWithPhaseSync(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                                       uint8_t duty, uint8_t hsHigh, uint8_t hsLow)
+{
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"cp %A[sig], %[duty]		; 1 cycle, C if high"		"\n\t"
+		"brcc 2f			; 1 cycle if not taken"		"\n\t"
+		"nop				; 1 cycle"			"\n\t"
+		"out %[sync], %[hsHigh]		; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 14 cycles"	"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"2:"								"\n\t"
+		"out %[sync], %[hsLow]		; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 14 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [sig] "+z"(signal)                                              // signal source
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [duty] "r"(duty), [hsHigh] "r"(hsHigh), [hsLow] "r"(hsLow),     // sync
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [sync] "I"(_SFR_IO_ADDR(HSPORT)),                               // sync port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// HS is toggled when the table index wraps (carry of the phase); both paths are 13 cycles
+inline void static signalWithToggleSync(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                                        uint8_t port, uint8_t mask)
+{
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle, C on wrap"		"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"brcc 2f			; 1 cycle if not taken"		"\n\t"
+		"eor %[port], %[mask]		; 1 cycle"			"\n\t"
+		"out %[sync], %[port]		; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 13 cycles"	"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"2:"								"\n\t"
+		"nop				; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 13 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [sig] "+z"(signal), [port] "+r"(port)                           // signal source, sync port value
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [mask] "r"(mask),                                               // sync bit
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [sync] "I"(_SFR_IO_ADDR(HSPORT)),                               // sync port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// the phase increment is selected by the HS input on every sample, the phase is continuous;
+// both paths are 13 cycles
+inline void static fskSignalOut(const uint8_t *signal, uint32_t accLow, uint32_t accHigh)
+{
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"1:"								"\n\t"
+		"sbic %[pin], %[hs]		; 2 cycles if low"		"\n\t"
+		"rjmp 2f			; 2 cycles"			"\n\t"
+		"nop				; 1 cycle"			"\n\t"
+		"add r17, %A[lo]		; 1 cycle"			"\n\t"
+		"adc r18, %B[lo]		; 1 cycle"			"\n\t"
+		"adc r19, %C[lo]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %D[lo]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 13 cycles"	"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"2:"								"\n\t"
+		"add r17, %A[hi]		; 1 cycle"			"\n\t"
+		"adc r18, %B[hi]		; 1 cycle"			"\n\t"
+		"adc r19, %C[hi]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %D[hi]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 13 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [sig] "+z"(signal)                                              // signal source
+		: [lo] "r"(accLow), [hi] "r"(accHigh),                            // phase increments
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                   // key input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// the sample is read at the phase shifted by %[shift] while the HS input is high;
+// X points to the sample, the skipped add keeps the loop at 13 cycles
+inline void static pskSignalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0, uint8_t shift)
+{
+	const uint8_t *sample = signal;
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
+		"mov %A[smp], %A[sig]		; 1 cycle"			"\n\t"
+		"sbic %[pin], %[hs]		; 2 cycles together"		"\n\t"
+		"add %A[smp], %[shift]		; "				"\n\t"
+		"ld __tmp_reg__, X 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 13 cycles"	"\n\t"
+		: [sig] "+z"(signal), [smp] "+x"(sample)                          // signal source, sample
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [shift] "r"(shift),                                             // phase shift
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                   // key input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// two 24-bit phase accumulators: the first indexes the table by Z, the second by X;
+// the samples are summed, 15 cycles
+inline void static dualToneOut(const uint8_t *signal, uint8_t a2, uint8_t a1, uint8_t a0,
+                               uint8_t b2, uint8_t b1, uint8_t b0)
+{
+	const uint8_t *sample = signal;
+	asm volatile(
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"eor r20, r20 			; r20<-0"			"\n\t"
+		"eor r21, r21 			; r21<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add r18, %[a0]			; 1 cycle"			"\n\t"
+		"adc r19, %[a1]			; 1 cycle"			"\n\t"
+		"adc %A[sig], %[a2]		; 1 cycle"			"\n\t"
+		"add r20, %[b0]			; 1 cycle"			"\n\t"
+		"adc r21, %[b1]			; 1 cycle"			"\n\t"
+		"adc %A[smp], %[b2]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"ld r22, X	 		; 2 cycles" 			"\n\t"
+		"add __tmp_reg__, r22		; 1 cycle"			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 15 cycles"	"\n\t"
+		: [sig] "+z"(signal), [smp] "+x"(sample)                          // tones
+		: [a0] "r"(a0), [a1] "r"(a1), [a2] "r"(a2),                       // first phase increment
+		  [b0] "r"(b0), [b1] "r"(b1), [b2] "r"(b2),                       // second phase increment
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r18", "r19", "r20", "r21", "r22"
 	);
 }
 
+// plays a flash record by a 24-bit fraction and the 16-bit flash address in Z: 8.24 samples per tick;
+// at the end the address is wrapped back by the length (7 more cycles) or the one-shot returns; 15 cycles
+inline void static recordOut(const uint8_t **position, uint32_t *fraction, uint32_t inc,
+                             const uint8_t *end, uint16_t length, bool loop)
+{
+	const uint8_t *sample = *position;
+	uint32_t frac = *fraction;
+	asm volatile(
+		"1:"								"\n\t"
+		"add %A[frac], %A[inc]		; 1 cycle"			"\n\t"
+		"adc %B[frac], %B[inc]		; 1 cycle"			"\n\t"
+		"adc %C[frac], %C[inc]		; 1 cycle"			"\n\t"
+		"adc %A[smp], %D[inc]		; 1 cycle"			"\n\t"
+		"adc %B[smp], __zero_reg__	; 1 cycle"			"\n\t"
+		"cp %A[smp], %A[end]		; 1 cycle"			"\n\t"
+		"cpc %B[smp], %B[end]		; 1 cycle"			"\n\t"
+		"brsh 3f			; 1 cycle if not taken"		"\n\t"
+		"2:"								"\n\t"
+		"lpm __tmp_reg__, Z		; 3 cycles"			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 15 cycles"	"\n\t"
+		"rjmp 4f			; stopped"			"\n\t"
+		"3:"								"\n\t"
+		"sbrs %[loop], 0		; 2 cycles with the skip (+1 for brsh)"	"\n\t"
+		"rjmp 4f			; the end: one-shot returns"	"\n\t"
+		"sub %A[smp], %A[len]		; 1 cycle"			"\n\t"
+		"sbc %B[smp], %B[len]		; 1 cycle"			"\n\t"
+		"rjmp 2b			; 2 cycles. 7 more at the wrap"	"\n\t"
+		"4:"								"\n\t"
+		: [smp] "+z"(sample), [frac] "+r"(frac)                           // position
+		: [inc] "r"(inc),                                                 // phase increment
+		  [end] "r"(end), [len] "r"(length), [loop] "r"(loop),            // record
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+	);
+	*position = sample;
+	*fraction = frac;
+}
+
 inline void static signalWithSyncOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0)
 {
 	asm volatile(
@@ -1741,14 +4863,14 @@ inline void static signalWithSyncOut(const uint8_t *signal, uint8_t ad3, uint8_t
 		"sbrs r30, 7			; "				"\n\t"
 		"sbi %[sync], 5			; "				"\n\t"
 
-		"sbis %[cond], 2		; 1 cycle if no skip" 		"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
 		"rjmp 1b			; 2 cycles. Total 15 cycles"	"\n\t"
 		:
 		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
 		  [sig] "z"(signal),                                              // signal source
 		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
 		  [sync] "I"(_SFR_IO_ADDR(HSPORT)),                               // sync port
-		  [cond] "I"(_SFR_IO_ADDR(SPCR))                                  // exit condition
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
 		: "r17", "r18", "r19" 
 	);
 }
@@ -1769,12 +4891,12 @@ inline void static randomSignalOut(const uint8_t *signal)
 		"mov r30, __tmp_reg__		; 1 c"				"\n\t"
 
 		"2:"								"\n\t"
-		"sbis %[cond], 2		; 1 c"		 		"\n\t"
+		"sbis %[cond], %[stop]		; 1 c"		 		"\n\t"
 		"rjmp 1b			; 2 c. Total 10/11 cycles"	"\n\t"
 		:
 		: [sig] "z"(signal),                              // signal source
 		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),               // output port
-		  [cond] "I"(_SFR_IO_ADDR(SPCR))                  // exit condition
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT) // exit condition
 		: "r18", "r19" 
 	);
 }
@@ -1864,7 +4986,7 @@ inline void static sweepOut(const uint8_t *signal, uint8_t startIndex,
 
 		// check exit condition
 		"6:             	        ; "				"\n\t"
-		"sbis %[cond], 2		; 1 c"		 		"\n\t"
+		"sbis %[cond], %[stop]		; 1 c"		 		"\n\t"
 		"rjmp 1b			; 2 c"				"\n\t"
 
 		// exit
@@ -1873,23 +4995,341 @@ inline void static sweepOut(const uint8_t *signal, uint8_t startIndex,
 		: [a0] "r"(a0), [a1] "r"(a1), [a2] "r"(a2),            // phase increment
 		  [sig] "z"(signal + startIndex),                      // signal source
 		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                    // output port
-		  [cond] "I"(_SFR_IO_ADDR(SPCR)),                      // exit condition
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT), // exit condition
 		  [i0] "r"(i0), [i1] "r"(i1), [i2] "r"(i2),            // increment of the increment
 		  [e0] "r"(e0), [e1] "r"(e1), [e2] "r"(e2)             // stop value
 		: "r18", "r19"
 	);
 }
 
+// Waits for the level %[high] (0 or 1) on the HS input, then waits 6 * %[d] - 1 cycles
+// (%[d] must not be 0). Jumps to "9f" if the stop flag is set.
+// Both branches take 4 cycles from the sampling of the input to the delay loop,
+// the polling period (and the jitter) is 5 cycles.
+#define TRIGGER_WAIT_ASM \
+	"sbrs %[high], 0		; "				"\n\t" \
+	"rjmp 2f			; "				"\n\t" \
+	"1:"								"\n\t" \
+	"sbic %[cond], %[stop]		; 2 c if not stopped"		"\n\t" \
+	"rjmp 9f			; "				"\n\t" \
+	"sbis %[pin], %[hs]		; 1 c if low, 2 c if high"	"\n\t" \
+	"rjmp 1b			; 2 c. Total 5 cycles"		"\n\t" \
+	"rjmp 3f			; 2 c"				"\n\t" \
+	"2:"								"\n\t" \
+	"sbic %[cond], %[stop]		; 2 c if not stopped"		"\n\t" \
+	"rjmp 9f			; "				"\n\t" \
+	"sbic %[pin], %[hs]		; 1 c if high, 2 c if low"	"\n\t" \
+	"rjmp 2b			; 2 c. Total 5 cycles"		"\n\t" \
+	"nop				; 1 c"				"\n\t" \
+	"nop				; 1 c"				"\n\t" \
+	"3:"								"\n\t" \
+	"subi %[d0], 1			; 1 c"				"\n\t" \
+	"sbci %[d1], 0			; 1 c"				"\n\t" \
+	"sbci %[d2], 0			; 1 c"				"\n\t" \
+	"sbci %[d3], 0			; 1 c"				"\n\t" \
+	"brne 3b			; 2 c, 1 c on exit"		"\n\t"
+
+inline void static triggerWait(uint8_t high, uint32_t count)
+{
+	uint8_t d0 = count, d1 = count >> 8, d2 = count >> 16, d3 = count >> 24;
+	asm volatile(
+		TRIGGER_WAIT_ASM
+		"9:"								"\n\t"
+		: [d0] "+d"(d0), [d1] "+d"(d1), [d2] "+d"(d2), [d3] "+d"(d3)   // delay
+		: [high] "r"(high),                                             // trigger level
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                 // trigger input
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)      // exit condition
+	);
+}
+
+// signalOut() started by the trigger; the first sample is written
+// 6 * count + 10 cycles after the sampling of the trigger input
+inline void static triggeredSignalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                                      uint8_t high, uint32_t count)
+{
+	uint8_t d0 = count, d1 = count >> 8, d2 = count >> 16, d3 = count >> 24;
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		TRIGGER_WAIT_ASM
+		"4:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 4b			; 2 cycles. Total 10 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [d0] "+d"(d0), [d1] "+d"(d1), [d2] "+d"(d2), [d3] "+d"(d3),  // delay
+		  [sig] "+z"(signal)                                            // signal source
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [high] "r"(high),                                               // trigger level
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                   // trigger input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// Outputs %[n] + 1 periods, the end of a period is detected by the carry from Z;
+// the trigger wait is skipped if bit 7 of %[high] is set (NO_TRIGGER)
+inline void static burstOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                            uint16_t n, uint8_t high, uint32_t count)
+{
+	uint8_t d0 = count, d1 = count >> 8, d2 = count >> 16, d3 = count >> 24;
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"sbrc %[high], 7		; "				"\n\t"
+		"rjmp 4f			; "				"\n\t"
+		TRIGGER_WAIT_ASM
+		"4:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle, carry on new period"	"\n\t"
+		"sbc %A[n], __zero_reg__	; 1 cycle"			"\n\t"
+		"sbc %B[n], __zero_reg__	; 1 cycle"			"\n\t"
+		"brcs 9f			; 1 cycle, exit after the last period"	"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 4b			; 2 cycles. Total 13 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [d0] "+d"(d0), [d1] "+d"(d1), [d2] "+d"(d2), [d3] "+d"(d3),  // delay
+		  [n] "+r"(n),                                                  // periods counter
+		  [sig] "+z"(signal)                                            // signal source
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [high] "r"(high),                                               // trigger level
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                   // trigger input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// signalOut() gated by the HS input: while it is low, the phase is not incremented
+// and the output holds its value (hold) or the off level; each path takes 12 cycles
+inline void static gatedSignalOut(const uint8_t *signal, uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0,
+                                  uint8_t off, bool hold)
+{
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"1:"								"\n\t"
+		"sbis %[gate], %[hs]		; 2 cycles if high"		"\n\t"
+		"rjmp 2f			; "				"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc %A[sig], %[ad3]		; 1 cycle"			"\n\t"
+		"ld __tmp_reg__, Z 		; 2 cycles" 			"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 12 cycles"	"\n\t"
+		"rjmp 9f			; "				"\n\t"
+
+		// gate is low: 3 cycles till here
+		"2:"								"\n\t"
+		"sbrs %[hold], 0		; 2 cycles together"		"\n\t"
+		"out %[out], %[off]		; "				"\n\t"
+		"rjmp .+0			; 2 cycles"			"\n\t"
+		"rjmp .+0			; 2 cycles"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 12 cycles"	"\n\t"
+		"9:"								"\n\t"
+		: [sig] "+z"(signal)                                              // signal source
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [off] "r"(off), [hold] "r"(hold),                               // gate low output
+		  [gate] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),                  // gate input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19"
+	);
+}
+
+// analog PWM without a table: the output is 0xFF while the upper 16 bits of the phase
+// are below the duty and 0 otherwise; 11 cycles
+inline void static pwmCompareOut(uint8_t ad3, uint8_t ad2, uint8_t ad1, uint8_t ad0, uint8_t dh, uint8_t dl)
+{
+	asm volatile(
+		"eor r17, r17 			; r17<-0"			"\n\t"
+		"eor r18, r18 			; r18<-0"			"\n\t"
+		"eor r19, r19 			; r19<-0"			"\n\t"
+		"eor r20, r20 			; r20<-0"			"\n\t"
+		"1:"								"\n\t"
+		"add r17, %[ad0]		; 1 cycle"			"\n\t"
+		"adc r18, %[ad1]		; 1 cycle"			"\n\t"
+		"adc r19, %[ad2]		; 1 cycle"			"\n\t"
+		"adc r20, %[ad3]		; 1 cycle"			"\n\t"
+		"cp r19, %[dl]			; 1 cycle"			"\n\t"
+		"cpc r20, %[dh]			; 1 cycle, C if phase < duty"	"\n\t"
+		"sbc __tmp_reg__, __tmp_reg__	; 1 cycle, 0xFF or 0"		"\n\t"
+		"out %[out], __tmp_reg__	; 1 cycle"			"\n\t"
+		"sbis %[cond], %[stop]		; 1 cycle if no skip" 		"\n\t"
+		"rjmp 1b			; 2 cycles. Total 11 cycles"	"\n\t"
+		:
+		: [ad0] "r"(ad0), [ad1] "r"(ad1), [ad2] "r"(ad2), [ad3] "r"(ad3), // phase increment
+		  [dh] "r"(dh), [dl] "r"(dl),                                     // duty
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),                               // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT)        // exit condition
+		: "r17", "r18", "r19", "r20"
+	);
+}
+
+// Starts Timer1 and stops it exactly after the delay, the interrupts are disabled in between.
+// Short delay: k + 3 cycles (k = 0..7); long delay: 6 * n + r + 2 cycles (n >= 1, r = 0..5).
+inline void static hsBurstOut(bool isShort, uint32_t n, uint8_t r, uint8_t psr, uint8_t tccr)
+{
+	uint8_t d0 = n, d1 = n >> 8, d2 = n >> 16, d3 = n >> 24;
+	asm volatile(
+		"sbrs %[sh], 0		; "				"\n\t"
+		"rjmp 1f			; "				"\n\t"
+		"ldi r30, pm_lo8(6f)		; "				"\n\t"
+		"ldi r31, pm_hi8(6f)		; "				"\n\t"
+		"rjmp 2f			; "				"\n\t"
+		"1:"								"\n\t"
+		"ldi r30, pm_lo8(5f)		; "				"\n\t"
+		"ldi r31, pm_hi8(5f)		; "				"\n\t"
+		"2:"								"\n\t"
+		"sub r30, %[r]			; "				"\n\t"
+		"sbc r31, __zero_reg__		; "				"\n\t"
+
+		"cli				; "				"\n\t"
+		"out %[sfior], %[psr]		; reset the prescaler"		"\n\t"
+		"out %[tccr1b], %[tccr]		; cycle 0: start Timer1"	"\n\t"
+		"ijmp				; 2 c"				"\n\t"
+		"nop				; r cycles"			"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"5:"								"\n\t"
+		"subi %[d0], 1			; 1 c"				"\n\t"
+		"sbci %[d1], 0			; 1 c"				"\n\t"
+		"sbci %[d2], 0			; 1 c"				"\n\t"
+		"sbci %[d3], 0			; 1 c"				"\n\t"
+		"brne 5b			; 2 c, 1 c on exit"		"\n\t"
+		"out %[tccr1b], __zero_reg__	; stop Timer1"			"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"nop				; k cycles"			"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"6:"								"\n\t"
+		"out %[tccr1b], __zero_reg__	; stop Timer1"			"\n\t"
+		"9:"								"\n\t"
+		"sei				; "				"\n\t"
+		: [d0] "+d"(d0), [d1] "+d"(d1), [d2] "+d"(d2), [d3] "+d"(d3)   // long delay
+		: [sh] "r"(isShort), [r] "r"(r),                             // delay kind, remainder
+		  [psr] "r"(psr), [tccr] "r"(tccr),                             // timer start
+		  [sfior] "I"(_SFR_IO_ADDR(SFIOR)), [tccr1b] "I"(_SFR_IO_ADDR(TCCR1B))
+		: "r30", "r31"
+	);
+}
+
 void timer1Start(uint8_t freqMHz)
 {
 	switch(freqMHz) {
-		case 2:  OCR1A = 3; break;
-		case 4:  OCR1A = 1; break;
-		case 8:  OCR1A = 0; break;
-		default: OCR1A = 7; // 1 MHz
+		case 2:  timer1StartCtc(1, 3); break;
+		case 4:  timer1StartCtc(1, 1); break;
+		case 8:  timer1StartCtc(1, 0); break;
+		default: timer1StartCtc(1, 7); // 1 MHz
+	}
+}
+
+void timer1StartCtc(uint8_t cs, uint16_t ocr)
+{
+	TCCR1B = timer1SetupCtc(cs, ocr);
+}
+
+// sets the CTC mode up; returns TCCR1B value which starts the timer
+uint8_t timer1SetupCtc(uint8_t cs, uint16_t ocr)
+{
+	OCR1A  = ocr;
+	TCNT1  = 0;
+	TCCR1A = (1 << COM1A0);     // output compare toggles OC1A pin
+	return (1 << WGM12) | cs;   // CTC, TOP = OCR1A
+}
+
+// frequency of OC1A toggled in the CTC mode, the calibration is respected
+double timer1CtcFreq(uint8_t cs, uint16_t ocr)
+{
+	return (double)CPU_FREQ / config.freqCal / 2 / pgm_read_word(&TIMER1_DIVS[cs - 1]) / ((uint32_t)ocr + 1);
+}
+
+// finds the prescaller and OCR1A value with the nearest CTC frequency;
+// returns the clock select bits, the OCR1A value is stored in *ocr
+uint8_t timer1FindCtc(double freq, uint16_t *ocr)
+{
+	uint8_t best = 1;
+	double bestError = INFINITY;
+	for(uint8_t cs = 1; cs <= 5; ++cs) {
+		double n = (double)CPU_FREQ / config.freqCal / 2 / pgm_read_word(&TIMER1_DIVS[cs - 1]) / freq;
+		if(n < 1.0)     n = 1.0;
+		if(n > 65536.0) n = 65536.0;
+		uint16_t o = (uint32_t)(n + 0.5) - 1;
+
+		double error = fabs(timer1CtcFreq(cs, o) - freq);
+		if(error < bestError) {
+			best      = cs;
+			bestError = error;
+			*ocr      = o;
+		}
+	}
+	return best;
+}
+
+// PWM frequency with TOP = ICR1, the calibration is respected
+double timer1PwmFreq(uint8_t cs, uint16_t top, bool phaseCorrect)
+{
+	double clock = (double)CPU_FREQ / config.freqCal / pgm_read_word(&TIMER1_DIVS[cs - 1]);
+	return phaseCorrect ? clock / 2 / top : clock / ((uint32_t)top + 1);
+}
+
+// finds the smallest prescaller (so the biggest TOP and the best duty resolution) for the PWM frequency;
+// returns the clock select bits, TOP is stored in *top
+uint8_t timer1FindPwm(double freq, bool phaseCorrect, uint16_t *top)
+{
+	uint8_t cs;
+	double t = 0.0;
+	for(cs = 1; cs <= 5; ++cs) {
+		double clock = (double)CPU_FREQ / config.freqCal / pgm_read_word(&TIMER1_DIVS[cs - 1]);
+		t = phaseCorrect ? clock / 2 / freq : clock / freq - 1;
+		if(t < 65535.5) break;
 	}
-	TCCR1A = (1 << COM1A0); // output compare toggles OC1A pin
-	TCCR1B = 0b00001001;    // start timer without prescaler
+	if(cs > 5)      cs = 5;
+	if(t < 3.0)     t = 3.0;      // 2-bit resolution at least
+	if(t > 65535.0) t = 65535.0;
+	*top = (uint16_t)(t + 0.5);
+	return cs;
+}
+
+// Fast PWM (mode 14) or phase correct PWM (mode 10) with TOP = ICR1; non-inverting
+void timer1StartPwmIcr(uint8_t cs, uint16_t top, uint16_t ocr, bool phaseCorrect)
+{
+	TCCR1B = 0;
+	TCCR1B = timer1SetupPwmIcr(cs, top, ocr, phaseCorrect);
+}
+
+// sets the PWM with TOP = ICR1 up; returns TCCR1B value which starts the timer
+uint8_t timer1SetupPwmIcr(uint8_t cs, uint16_t top, uint16_t ocr, bool phaseCorrect)
+{
+	TCCR1A = (1 << COM1A1) | (1 << WGM11);
+	ICR1   = top;
+	OCR1A  = ocr;
+	TCNT1  = 0;
+	return phaseCorrect
+		? (1 << WGM13) | cs
+		: (1 << WGM13) | (1 << WGM12) | cs;
 }
 
 void timer1StartPwm(uint16_t freqHz)
@@ -1908,12 +5348,898 @@ void timer1StartPwm(uint16_t freqHz)
 	TCCR1B = (1 << WGM12) | prescaler;
 }
 
+// Waits for the trigger (unless bit 7 of %[trig] is set), the trigger delay and outputs one pulse.
+// Both delays are made by a computed jump into a nop ladder (the remainder, 0..4 cycles)
+// followed by the 5-cycle loop, so any length from PULSE_MIN_TICKS is exact.
+// Pulse width is 5 * wn + wr + 4 cycles.
+inline void static pulseOut(uint8_t trig, uint32_t dn, uint8_t dr, uint32_t wn, uint8_t wr,
+                            uint8_t high, uint8_t low, uint8_t hsHigh, uint8_t hsLow)
+{
+	uint8_t d0 = dn, d1 = dn >> 8, d2 = dn >> 16;
+	uint8_t w0 = wn, w1 = wn >> 8, w2 = wn >> 16;
+	asm volatile(
+		// entry points into the ladders: Z for the delay, X for the width
+		"ldi r30, pm_lo8(4f)		; "				"\n\t"
+		"ldi r31, pm_hi8(4f)		; "				"\n\t"
+		"sub r30, %[dr]			; "				"\n\t"
+		"sbc r31, __zero_reg__		; "				"\n\t"
+		"ldi r26, pm_lo8(6f)		; "				"\n\t"
+		"ldi r27, pm_hi8(6f)		; "				"\n\t"
+		"sub r26, %[wr]			; "				"\n\t"
+		"sbc r27, __zero_reg__		; "				"\n\t"
+
+		"sbrc %[trig], 7		; "				"\n\t"
+		"rjmp 5f			; "				"\n\t"
+		"sbrs %[trig], 0		; "				"\n\t"
+		"rjmp 2f			; "				"\n\t"
+		"1:"								"\n\t"
+		"sbic %[cond], %[stop]		; 2 c if not stopped"		"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"sbis %[pin], %[hs]		; 1 c if low, 2 c if high"	"\n\t"
+		"rjmp 1b			; 2 c. Total 5 cycles"		"\n\t"
+		"rjmp 3f			; 2 c"				"\n\t"
+		"2:"								"\n\t"
+		"sbic %[cond], %[stop]		; 2 c if not stopped"		"\n\t"
+		"rjmp 9f			; "				"\n\t"
+		"sbic %[pin], %[hs]		; 1 c if high, 2 c if low"	"\n\t"
+		"rjmp 2b			; 2 c. Total 5 cycles"		"\n\t"
+		"nop				; 1 c"				"\n\t"
+		"nop				; 1 c"				"\n\t"
+
+		// trigger delay: 5 * dn + dr + 1 cycles
+		"3:"								"\n\t"
+		"ijmp				; 2 c"				"\n\t"
+		"nop				; dr cycles"			"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"4:"								"\n\t"
+		"subi %[d0], 1			; 1 c"				"\n\t"
+		"sbci %[d1], 0			; 1 c"				"\n\t"
+		"sbci %[d2], 0			; 1 c"				"\n\t"
+		"brne 4b			; 2 c, 1 c on exit"		"\n\t"
+
+		// the pulse
+		"5:"								"\n\t"
+		"cli				; 1 c"				"\n\t"
+		"out %[out], %[high]		; 1 c"				"\n\t"
+		"out %[hsport], %[hsHigh]	; 1 c"				"\n\t"
+		"movw r30, r26			; 1 c"				"\n\t"
+		"ijmp				; 2 c"				"\n\t"
+		"nop				; wr cycles"			"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"nop				; "				"\n\t"
+		"6:"								"\n\t"
+		"subi %[w0], 1			; 1 c"				"\n\t"
+		"sbci %[w1], 0			; 1 c"				"\n\t"
+		"sbci %[w2], 0			; 1 c"				"\n\t"
+		"brne 6b			; 2 c, 1 c on exit"		"\n\t"
+		"out %[out], %[low]		; 1 c"				"\n\t"
+		"out %[hsport], %[hsLow]	; 1 c"				"\n\t"
+		"sei				; "				"\n\t"
+		"9:"								"\n\t"
+		: [d0] "+d"(d0), [d1] "+d"(d1), [d2] "+d"(d2),    // trigger delay
+		  [w0] "+d"(w0), [w1] "+d"(w1), [w2] "+d"(w2)     // pulse width
+		: [dr] "r"(dr), [wr] "r"(wr),                     // remainders
+		  [trig] "r"(trig),                               // trigger level
+		  [high] "r"(high), [low] "r"(low),               // output levels
+		  [hsHigh] "r"(hsHigh), [hsLow] "r"(hsLow),       // HS port values
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS),   // trigger input
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),               // output port
+		  [hsport] "I"(_SFR_IO_ADDR(HSPORT)),             // HS port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT) // exit condition
+		: "r26", "r27", "r30", "r31"
+	);
+}
+
+// output of the HS pin to the R2R port as high/low; 7 cycles per loop
+inline void static mirrorHsOut(uint8_t high, uint8_t low)
+{
+	asm volatile(
+		"1:"								"\n\t"
+		"sbic %[pin], %[hs]		; 2 c together"			"\n\t"
+		"out %[out], %[high]		; "				"\n\t"
+		"sbis %[pin], %[hs]		; 2 c together"			"\n\t"
+		"out %[out], %[low]		; "				"\n\t"
+		"sbis %[cond], %[stop]		; 1 c"				"\n\t"
+		"rjmp 1b			; 2 c. Total 7 cycles"		"\n\t"
+		:
+		: [high] "r"(high), [low] "r"(low),             // output levels
+		  [pin] "I"(_SFR_IO_ADDR(HSPIN)), [hs] "I"(HS), // HS pin
+		  [out] "I"(_SFR_IO_ADDR(R2RPORT)),             // output port
+		  [cond] "I"(_SFR_IO_ADDR(STOP_REG)), [stop] "I"(STOP_BIT) // exit condition
+	);
+}
+
+// selects the smallest prescaller which fits the period of 'ticks' CPU cycles into 16 bits;
+// returns the clock select bits, the divider is stored in *div
+uint8_t timer1Prescaler(uint32_t ticks, uint16_t *div)
+{
+	uint8_t cs = 1;
+	*div = 1;
+	while(cs < 5 && ticks / *div > 65536) {
+		++cs;
+		*div = pgm_read_word(&TIMER1_DIVS[cs - 1]);
+	}
+	return cs;
+}
+
+void timer1StartPulseTrain(uint8_t cs, uint16_t top, uint16_t ocr, uint16_t tcnt)
+{
+	TCCR1B = 0;
+	TCCR1A = (1 << COM1A1) | (1 << FOC1A); // normal mode: clear OC1A, OCR1x are not buffered
+	OCR1A  = ocr;
+	OCR1B  = ocr / 2;                       // in the middle of the low phase
+	ICR1   = top;
+	TCNT1  = tcnt;
+
+	// Fast PWM, TOP = ICR1; inverting
+	TCCR1A = (1 << COM1A1) | (1 << COM1A0) | (1 << WGM11);
+	TCCR1B = (1 << WGM13) | (1 << WGM12) | cs;
+}
+
 void timer1Stop(void)
 {
 	TCCR1A = 0; // release the OC1A pin
 	TCCR1B = 0; // timer off
 }
 
+#if LIBRARY
+// SPI NOR flash waveform library, the format is in library.h
+const char LIBRARY_MAGIC[] PROGMEM = LIB_MAGIC;
+
+uint16_t libraryCount;           // entries, 0 - no library found
+
+uint8_t spiTransfer(uint8_t data) {
+	SPDR = data;
+	loop_until_bit_is_set(SPSR, SPIF);
+	return SPDR;
+}
+
+// 16 cycles per byte at F_CPU / 2, 0.4 ms for the whole signalBuffer
+void libraryRead(uint32_t address, void *data, uint16_t size) {
+	uint8_t *p = data;
+	LIB_PORT &= ~(1 << LIB_CS);
+	spiTransfer(0x03);           // read data
+	spiTransfer(address >> 16);
+	spiTransfer(address >> 8);
+	spiTransfer(address);
+	while(size-- != 0) *p++ = spiTransfer(0);
+	LIB_PORT |= (1 << LIB_CS);
+}
+
+void libraryReadEntry(uint16_t num, struct LibraryEntry *entry) {
+	libraryRead(LIB_ENTRIES + (uint32_t)num * sizeof(*entry), entry, sizeof(*entry));
+	entry->name[sizeof(entry->name) - 1] = 0;
+}
+
+void libraryInit(void) {
+	LIB_PORT |= (1 << LIB_CS) | (1 << LIB_MISO);    // deselected; the pull-up reads 0xFF without the flash
+	LIB_DDR  |= (1 << LIB_CS) | (1 << LIB_MOSI) | (1 << LIB_SCK);
+	SPCR = (1 << SPE) | (1 << MSTR);                 // master, mode 0
+	SPSR = (1 << SPI2X);                             // F_CPU / 2
+
+	struct LibraryHeader header;
+	libraryRead(0, &header, sizeof(header));
+	libraryCount = (memcmp_P(header.magic, LIBRARY_MAGIC, sizeof(header.magic)) == 0) ? header.count : 0;
+	if(config.libraryEntry >= libraryCount) config.libraryEntry = 0;
+}
+
+void library_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	if(libraryCount == 0) {
+		print_P(PSTR("No library   "));
+	}
+	else {
+		struct LibraryEntry entry;
+		libraryReadEntry(config.libraryEntry, &entry);
+		print_P(PSTR("%-13s"), entry.name);
+	}
+	displaySignalStatus();
+}
+
+// selects the entry when stopped, changes the frequency while running
+void library_onLeft(void) {
+	if(running) {
+		signal_onLeft();
+		return;
+	}
+	if(config.libraryEntry > 0) --config.libraryEntry;
+	library_updateDisplay();
+}
+
+void library_onRight(void) {
+	if(running) {
+		signal_onRight();
+		return;
+	}
+	if(config.libraryEntry + 1 < libraryCount) ++config.libraryEntry;
+	library_updateDisplay();
+}
+
+void library_onStart(void) {
+	if(!running) {
+		if(libraryCount == 0) return;
+
+		struct LibraryEntry entry;
+		libraryReadEntry(config.libraryEntry, &entry);
+		if(entry.freq > 0 && entry.freq <= MAX_FREQ) config.freq = entry.freq;
+
+		signal_start();
+		libraryRead(entry.address, signalBuffer, SIGNAL_BUFFER_SIZE);
+		while(running) {
+			signal_continue(true);
+		}
+		signal_stop();
+	}
+	else {
+		running = false;
+	}
+}
+#endif
+
+#if REMOTE
+/*USART remote control
+
+Text commands, one per line (CR or LF), the reply is a line:
+	<field>=<value>     set a config field, e.g. freq=1000.5 or harmAmp[2]=10 -> OK or ERR
+	<field>?            query a config field -> <field>=<value>
+	menu=<n>, menu?     select or query the main menu entry (only when stopped)
+	start, stop         as the START button when stopped, stop when running
+	status              -> running=<0|1> menu=<n>
+	up, down, left, right, opt - the buttons
+	save=<slot>, load=<slot>   store the uploaded ARB samples into the EEPROM slot, load them back
+	stream=<n>          play the next n bytes as samples at streamRate, see stream_run() -> OK,
+	                    at the end -> played=<n> underruns=<n> missed=<n> overruns=<n>
+	stream?             the statistics of the last stream
+Binary frames: REMOTE_SYNC, length, commands, checksum (length + commands + checksum = 0 mod 256);
+the commands of a frame are executed in order:
+	'S' id index value  set field id (index in REMOTE_FIELDS, the same in all builds), the value is little
+	                    endian of the field size; the enum values are the same in all builds too, a Sync Out
+	                    value of an option not built in is refused
+	'G' id index        get, the value is appended to the reply
+	'M' n               select the main menu entry
+	'R', 'X'            start, stop
+	'?'                 status, appends running and the menu entry
+	'B' button          enum Button
+	'W' slot, 'L' slot  save, load the ARB samples
+The reply frame is REMOTE_SYNC, length, result, data, checksum; result is 0 or the 1-based position
+of the failed command (bad checksum: 0xff).
+ARB upload: REMOTE_ARB_SYNC, SIGNAL_BUFFER_SIZE samples, checksum (samples + checksum = 0 mod 256),
+22 ms at 115200 baud. The samples are written straight into signalBuffer, a running ARB output changes
+on the fly, any other mode is stopped. The reply frame has the result only.
+A complete line, frame or upload sets the stop flag like the button interrupts (so does a half full
+receive ring), the DDS loop returns to signal_recheckButtons() which runs the commands and continues;
+the other modes are stopped by it. The HS burst and the counter set remoteHold: their commands wait
+in the ring until the burst or the measurement is over.
+*/
+enum FieldType {
+	FieldType_U8,      // uint8_t, bool and the enums (-fshort-enums)
+	FieldType_U16,
+	FieldType_Double
+};
+
+struct RemoteField {
+	char    name[16];
+	uint16_t offset;   // in struct Config
+	uint8_t type;      // enum FieldType
+	uint8_t count;     // array elements
+	float   min;
+	float   max;
+};
+
+#define REMOTE_FIELD(f, t, min, max) { #f, offsetof(struct Config, f), t, 1, min, max }
+#define REMOTE_ARRAY(f, t, min, max) { #f, offsetof(struct Config, f), t, sizeof(config.f) / sizeof(config.f[0]), min, max }
+
+const struct RemoteField REMOTE_FIELDS[] PROGMEM = {
+	REMOTE_FIELD(freq,            FieldType_Double, MIN_FREQ,         MAX_FREQ),
+	REMOTE_FIELD(freqCal,         FieldType_Double, MIN_FREQ_CAL,     MAX_FREQ_CAL),
+	REMOTE_FIELD(freqEnd,         FieldType_Double, MIN_FREQ,         MAX_FREQ),
+	REMOTE_FIELD(freqInc,         FieldType_Double, MIN_FREQ_INC,     MAX_FREQ_INC),
+	REMOTE_FIELD(hsFreq,          FieldType_U8,     1,                8),
+	REMOTE_FIELD(freqStep,        FieldType_Double, MIN_FREQ_STEP,    MAX_FREQ_STEP),
+	REMOTE_FIELD(freqMode,        FieldType_U8,     FreqMode_Exact,   FreqMode_Jitter),
+	REMOTE_FIELD(pwmFreq,         FieldType_U16,    61,               62500),
+	REMOTE_FIELD(pwmDuty,         FieldType_U8,     0,                255),
+	REMOTE_FIELD(offLevel,        FieldType_U8,     0,                255),
+	REMOTE_FIELD(pulse,           FieldType_Double, MIN_PULSE,        MAX_PULSE),
+	REMOTE_FIELD(syncOut,         FieldType_U8,     0,                SyncOut_End - 1),
+	REMOTE_FIELD(triggerDelay,    FieldType_Double, 0,                MAX_PULSE),
+	REMOTE_FIELD(triggerEdge,     FieldType_U8,     0,                TriggerEdge_End - 1),
+	REMOTE_FIELD(triggerHoldoff,  FieldType_Double, 0,                MAX_PULSE),
+	REMOTE_FIELD(burst,           FieldType_U16,    0,                MAX_BURST),
+	REMOTE_FIELD(burstRearm,      FieldType_U8,     0,                1),
+	REMOTE_FIELD(gateHold,        FieldType_U8,     0,                1),
+	REMOTE_FIELD(trainPeriod,     FieldType_Double, MIN_TRAIN_PERIOD, MAX_TRAIN_PERIOD),
+	REMOTE_FIELD(trainWidth,      FieldType_Double, 0,                MAX_TRAIN_PERIOD),
+	REMOTE_FIELD(trainCount,      FieldType_U16,    0,                MAX_BURST),
+	REMOTE_FIELD(trainDelay,      FieldType_Double, 0,                MAX_PULSE),
+	REMOTE_FIELD(hsClock,         FieldType_Double, MIN_HS_CLOCK,     MAX_HS_CLOCK),
+	REMOTE_FIELD(pwmHrFreq,       FieldType_Double, MIN_PWM_FREQ,     MAX_PWM_FREQ),
+	REMOTE_FIELD(pwmHrDuty,       FieldType_Double, 0,                1),
+	REMOTE_FIELD(pwmPhaseCorrect, FieldType_U8,     0,                1),
+	REMOTE_FIELD(pwmFine,         FieldType_U8,     0,                1),
+	REMOTE_FIELD(pwmFineDuty,     FieldType_U16,    0,                65535),
+	REMOTE_FIELD(hsLock,          FieldType_U8,     0,                1),
+	REMOTE_FIELD(hsBurst,         FieldType_U16,    0,                MAX_BURST),
+	REMOTE_FIELD(counterMode,     FieldType_U8,     0,                CounterMode_End - 1),
+	REMOTE_FIELD(counterGate,     FieldType_U16,    1,                MAX_COUNTER_GATE),
+	REMOTE_FIELD(counterAvg,      FieldType_U16,    1,                MAX_BURST),
+	REMOTE_FIELD(calRef,          FieldType_U8,     0,                sizeof(CAL_REFS) / sizeof(CAL_REFS[0]) - 1),
+	REMOTE_FIELD(syncPhase,       FieldType_U8,     0,                255),
+	REMOTE_FIELD(syncDuty,        FieldType_U8,     1,                255),
+	REMOTE_FIELD(startPhase,      FieldType_U8,     0,                255),
+	REMOTE_FIELD(finishPeriod,    FieldType_U8,     0,                1),
+	REMOTE_FIELD(fskFreq,         FieldType_Double, MIN_FREQ,         MAX_FREQ),
+	REMOTE_FIELD(pskPhase,        FieldType_U8,     0,                255),
+	REMOTE_FIELD(dtmfDigit,       FieldType_U8,     0,                sizeof(DTMF_DIGITS) - 2),
+	REMOTE_FIELD(toneFreq1,       FieldType_Double, MIN_FREQ,         MAX_FREQ),
+	REMOTE_FIELD(toneFreq2,       FieldType_Double, MIN_FREQ,         MAX_FREQ),
+	REMOTE_FIELD(shapeType,       FieldType_U8,     0,                ShapeType_End - 1),
+	REMOTE_FIELD(shapeSymmetry,   FieldType_U8,     1,                255),
+	REMOTE_FIELD(shapeDuty,       FieldType_U8,     1,                255),
+	REMOTE_ARRAY(harmAmp,         FieldType_U16,    0,                MAX_HARM_AMP),
+	REMOTE_ARRAY(harmPhase,       FieldType_U8,     0,                255),
+	REMOTE_FIELD(streamRate,      FieldType_U16,    MIN_STREAM_RATE,  MAX_STREAM_RATE),
+#if RECORD_PLAYBACK
+	REMOTE_FIELD(recordNum,       FieldType_U8,     0,                sizeof(RECORDS) / sizeof(RECORDS[0]) - 1),
+#else
+	REMOTE_FIELD(recordNum,       FieldType_U8,     0,                0),
+#endif
+	REMOTE_FIELD(recordLoop,      FieldType_U8,     0,                1),
+	REMOTE_FIELD(recordRate,      FieldType_Double, MIN_FREQ,         MAX_RECORD_RATE),
+	REMOTE_FIELD(libraryEntry,    FieldType_U16,    0,                65535),
+};
+static const uint8_t REMOTE_FIELDS_SIZE = (sizeof(REMOTE_FIELDS)/sizeof(REMOTE_FIELDS[0]));
+
+const char REMOTE_OK[]  PROGMEM = "OK\r\n";
+const char REMOTE_ERR[] PROGMEM = "ERR\r\n";
+
+enum RemoteState {
+	RemoteState_Idle,
+	RemoteState_Text,
+	RemoteState_Length,     // binary frame, the length byte is next
+	RemoteState_Frame,      // binary frame, the commands and the checksum
+	RemoteState_Upload      // ARB samples and the checksum
+};
+
+volatile uint8_t remoteRx[REMOTE_RX_SIZE];
+volatile uint8_t remoteRxHead;           // written by USART_RXC_vect
+volatile uint8_t remoteRxTail;
+uint8_t remoteLine[REMOTE_LINE];         // text command or binary frame being received
+uint8_t remoteLength;
+uint8_t remoteFrameLength;
+uint16_t remoteUpload;                   // ARB samples received
+uint8_t remoteSum;
+
+// USART stream, the samples are received into signalBuffer used as a ring
+volatile bool streaming;                 // the received bytes are samples
+volatile bool streamEndless;             // until the START button, otherwise streamLeft bytes
+volatile bool streamReceived;            // streamLeft bytes are received
+volatile uint32_t streamLeft;
+volatile uint8_t streamHead;             // written by USART_RXC_vect
+volatile uint8_t streamTail;
+uint32_t streamPlayed;
+uint16_t streamUnderruns;                // the buffer ran empty
+uint32_t streamMissed;                   // samples not played in time
+volatile uint16_t streamOverruns;        // bytes dropped on the full buffer
+enum RemoteState remoteState;
+bool remoteStart;                        // start after the reply
+
+static int remote_putc(char c, FILE *stream) {
+	loop_until_bit_is_set(UCSRA, UDRE);
+	UDR = c;
+	return 0;
+}
+
+static FILE remote_str = FDEV_SETUP_STREAM(remote_putc, NULL, _FDEV_SETUP_WRITE);
+
+void remote_init(void) {
+	UBRRH = (CPU_FREQ / 8 / REMOTE_BAUD - 1) >> 8;
+	UBRRL = (CPU_FREQ / 8 / REMOTE_BAUD - 1);
+	UCSRA = (1 << U2X);
+	UCSRC = (1 << URSEL) | (1 << UCSZ1) | (1 << UCSZ0);  // 8N1
+	UCSRB = (1 << RXCIE) | (1 << RXEN) | (1 << TXEN);
+}
+
+// stores the byte and stops the DDS loop like the buttons once a command is complete;
+// the stream samples go to signalBuffer
+ISR(USART_RXC_vect) {
+	static uint16_t left;   // bytes of the binary frame or of the ARB upload still to come
+	static bool length;     // the length byte of a binary frame is next
+	uint8_t c = UDR;
+	if(streaming && !streamReceived) {
+		if((uint8_t)(streamHead + 1) != streamTail)
+			signalBuffer[streamHead++] = c;
+		else
+			++streamOverruns;
+		if(!streamEndless && --streamLeft == 0)
+			streamReceived = true;
+		return;
+	}
+	uint8_t head = (remoteRxHead + 1) & (REMOTE_RX_SIZE - 1);
+	if(head != remoteRxTail) {
+		remoteRx[remoteRxHead] = c;
+		remoteRxHead = head;
+	}
+
+	bool complete = false;
+	if(left != 0) {
+		complete = (--left == 0);
+	}
+	else if(length) {
+		left = c + 1;       // the commands and the checksum
+		length = false;
+	}
+	else if(c == REMOTE_SYNC) {
+		length = true;
+	}
+	else if(c == REMOTE_ARB_SYNC) {
+		left = SIGNAL_BUFFER_SIZE + 1;
+	}
+	else {
+		complete = (c == '\r' || c == '\n');
+	}
+	if(!complete && ((remoteRxHead - remoteRxTail) & (REMOTE_RX_SIZE - 1)) >= REMOTE_RX_SIZE / 2)
+		complete = true;    // an ARB upload or a long line is processed in parts
+	if(complete && !remoteHold)
+		STOP_REG |= (1 << STOP_BIT);
+}
+
+uint8_t remote_fieldSize(uint8_t type) {
+	switch(type) {
+		case FieldType_U8:  return 1;
+		case FieldType_U16: return 2;
+		default:            return sizeof(double);
+	}
+}
+
+// address of the field element or NULL
+uint8_t *remote_field(uint8_t id, uint8_t index, struct RemoteField *field) {
+	if(id >= REMOTE_FIELDS_SIZE) return NULL;
+	memcpy_P(field, &REMOTE_FIELDS[id], sizeof(*field));
+	if(index >= field->count) return NULL;
+	return (uint8_t *)&config + field->offset + index * remote_fieldSize(field->type);
+}
+
+bool remote_set(uint8_t id, uint8_t index, double value) {
+	struct RemoteField field;
+	uint8_t *p = remote_field(id, index, &field);
+	if(p == NULL || value < field.min || value > field.max) return false;
+	if(p == (uint8_t *)&config.syncOut && !isSyncOutAvailable(value + 0.5)) return false;
+	switch(field.type) {
+		case FieldType_U8:  *p = value + 0.5;                 break;
+		case FieldType_U16: *(uint16_t *)p = value + 0.5;     break;
+		default:            *(double *)p = value;             break;
+	}
+	if(p == (uint8_t *)&config.syncOut) setHsDirection(); // as syncOut_onOpt() commits it
+	return true;
+}
+
+bool remote_get(uint8_t id, uint8_t index, double *value) {
+	struct RemoteField field;
+	uint8_t *p = remote_field(id, index, &field);
+	if(p == NULL) return false;
+	switch(field.type) {
+		case FieldType_U8:  *value = *p;                      break;
+		case FieldType_U16: *value = *(uint16_t *)p;          break;
+		default:            *value = *(double *)p;            break;
+	}
+	return true;
+}
+
+bool remote_selectMenu(uint8_t entry) {
+	if(running || entry >= MENU_SIZE) return false;
+	config.menuEntry = entry;
+	optMenuEntryNum = (uint8_t)-1;
+	submenuLevel = 0;
+	onNewMenuEntry();
+	return true;
+}
+
+bool remote_button(uint8_t button) {
+	switch(button) {
+		case Button_Up:    buttonHandlers->onUp();    break;
+		case Button_Right: buttonHandlers->onRight(); break;
+		case Button_Down:  buttonHandlers->onDown();  break;
+		case Button_Left:  buttonHandlers->onLeft();  break;
+		case Button_Opt:   buttonHandlers->onOpt();   break;
+		default:           return false;
+	}
+	return true;
+}
+
+void remote_stop(void) {
+	if(running) {
+		running = false;
+		STOP_REG |= (1 << STOP_BIT);
+	}
+}
+
+// the receive ring is armed before the OK, the host may send the samples right after it;
+// count 0 - endless, until the START button
+void stream_prepare(uint32_t count) {
+	streamHead      = 0;
+	streamTail      = 0;
+	streamLeft      = count;
+	streamEndless   = (count == 0);
+	streamReceived  = false;
+	streamPlayed    = 0;
+	streamUnderruns = 0;
+	streamMissed    = 0;
+	streamOverruns  = 0;
+	streaming       = true;
+}
+
+void stream_report(void) {
+	fprint_P(&remote_str, PSTR("played=%lu underruns=%u missed=%lu overruns=%u\r\n"),
+		streamPlayed, streamUnderruns, streamMissed, streamOverruns);
+}
+
+// selects the Stream menu entry and starts it after the reply
+bool stream_remoteStart(uint32_t count) {
+	struct MenuEntry entry;
+	uint8_t i = 0;
+	do {
+		memcpy_P(&entry, &MENU[i], sizeof(entry));
+	} while(entry.buttonHandlers.onStart != stream_onStart && ++i < MENU_SIZE);
+	if(count == 0 || !remote_selectMenu(i)) return false;
+	stream_prepare(count);
+	remoteStart = true;
+	return true;
+}
+
+// plays the received samples on the Timer1 compare flag (CTC, no interrupt): the sample fetched on the
+// previous tick is written first, so only the interrupts add jitter (USART_RXC_vect ~2.5 us).
+// The output starts with STREAM_PREFILL samples buffered, an empty buffer holds the last sample.
+void stream_run(void) {
+	uint8_t sample = config.offLevel;
+	bool started = false, empty = false, paused = false;
+
+	TCCR1A = 0;
+	TCNT1  = 0;
+	OCR1A  = CPU_FREQ / config.streamRate - 1;
+	TIFR   = (1 << OCF1A);
+	TCCR1B = (1 << WGM12) | (1 << CS10);   // CTC, TOP = OCR1A, no prescaler
+
+	while(running) {
+		STOP_REG &= ~(1 << STOP_BIT);
+		while(bit_is_clear(STOP_REG, STOP_BIT)) {
+			loop_until_bit_is_set(TIFR, OCF1A);
+			R2RPORT = sample;
+			TIFR = (1 << OCF1A);
+
+			uint8_t count = streamHead - streamTail;
+			if(!started) {
+				started = (count >= STREAM_PREFILL) || streamReceived;
+				if(!started) continue;
+			}
+
+			if(count != 0) {
+				sample = signalBuffer[streamTail++];
+				++streamPlayed;
+				empty = false;
+			}
+			else if(streamReceived) {
+				running = false;
+				break;
+			}
+			else {
+				if(!empty) ++streamUnderruns;
+				++streamMissed;
+				empty = true;
+			}
+
+			// software flow control of the host, TXD is idle while streaming
+			if(bit_is_set(UCSRA, UDRE)) {
+				if(!paused && count >= STREAM_XOFF) {
+					UDR = XOFF;
+					paused = true;
+				}
+				else if(paused && count < STREAM_XON) {
+					UDR = XON;
+					paused = false;
+				}
+			}
+		}
+		if(running) signal_recheckButtons();
+	}
+
+	TCCR1B = 0;
+	streaming = false;
+	if(paused) remote_putc(XON, NULL);
+}
+
+void stream_updateDisplay(void) {
+	LCDGotoXY(0, 1);
+	print_P(PSTR("%5uHz U%-5u"), config.streamRate, streamUnderruns);
+	displaySignalStatus();
+}
+
+void stream_onLeft(void) {
+	uint8_t i = sizeof(STREAM_RATES) / sizeof(STREAM_RATES[0]);
+	while(i != 0 && pgm_read_word(&STREAM_RATES[i - 1]) >= config.streamRate) --i;
+	if(i != 0) config.streamRate = pgm_read_word(&STREAM_RATES[i - 1]);
+	stream_updateDisplay();
+}
+
+void stream_onRight(void) {
+	uint8_t i = 0;
+	while(i < sizeof(STREAM_RATES) / sizeof(STREAM_RATES[0]) && pgm_read_word(&STREAM_RATES[i]) <= config.streamRate) ++i;
+	if(i < sizeof(STREAM_RATES) / sizeof(STREAM_RATES[0])) config.streamRate = pgm_read_word(&STREAM_RATES[i]);
+	stream_updateDisplay();
+}
+
+void stream_onStart(void) {
+	if(!running) {
+		if(!streaming) stream_prepare(0);
+		signal_start();
+		stream_run();
+		signal_stop();
+		stream_report();
+	}
+	else {
+		running = false;
+	}
+}
+
+// runs a text command, replies OK or ERR unless a query or the status is printed
+void remote_text(char *line) {
+	char *value = strchr(line, '=');
+	size_t n = strlen(line);
+	bool query = (value == NULL) && (n > 0) && (line[n - 1] == '?');
+	if(value != NULL) *value++ = 0;
+	if(query) line[n - 1] = 0;
+
+	uint8_t index = 0;
+	char *bracket = strchr(line, '[');
+	if(bracket != NULL) {
+		*bracket = 0;
+		index = atoi(bracket + 1);
+	}
+
+	bool ok = true;
+	if(strcmp_P(line, PSTR("menu")) == 0) {
+		if(query) {
+			fprint_P(&remote_str, PSTR("menu=%u\r\n"), config.menuEntry);
+			return;
+		}
+		ok = (value != NULL) && remote_selectMenu(atoi(value));
+	}
+	else if(strcmp_P(line, PSTR("save")) == 0) {
+		ok = (value != NULL) && arb_save(atoi(value));
+	}
+	else if(strcmp_P(line, PSTR("load")) == 0) {
+		ok = (value != NULL) && arb_load(atoi(value));
+	}
+	else if(strcmp_P(line, PSTR("stream")) == 0) {
+		if(query) {
+			stream_report();
+			return;
+		}
+		ok = (value != NULL) && stream_remoteStart(atol(value));
+	}
+	else if(value == NULL && !query) {
+		if(strcmp_P(line, PSTR("status")) == 0) {
+			fprint_P(&remote_str, PSTR("running=%u menu=%u\r\n"), running, config.menuEntry);
+			return;
+		}
+		else if(strcmp_P(line, PSTR("start")) == 0) remoteStart = true;
+		else if(strcmp_P(line, PSTR("stop")) == 0)  remote_stop();
+		else if(strcmp_P(line, PSTR("up")) == 0)    remote_button(Button_Up);
+		else if(strcmp_P(line, PSTR("down")) == 0)  remote_button(Button_Down);
+		else if(strcmp_P(line, PSTR("left")) == 0)  remote_button(Button_Left);
+		else if(strcmp_P(line, PSTR("right")) == 0) remote_button(Button_Right);
+		else if(strcmp_P(line, PSTR("opt")) == 0)   remote_button(Button_Opt);
+		else ok = false;
+	}
+	else {
+		uint8_t id = 0;
+		while(id < REMOTE_FIELDS_SIZE && strcmp_P(line, REMOTE_FIELDS[id].name) != 0) ++id;
+		if(query) {
+			double v;
+			ok = remote_get(id, index, &v);
+			if(ok) {
+				if(bracket != NULL) fprint_P(&remote_str, PSTR("%s[%u]=%f\r\n"), line, index, v);
+				else                fprint_P(&remote_str, PSTR("%s=%f\r\n"), line, v);
+				return;
+			}
+		}
+		else {
+			ok = remote_set(id, index, atof(value));
+		}
+	}
+	fputs_P(ok ? REMOTE_OK : REMOTE_ERR, &remote_str);
+}
+
+void remote_sendFrame(uint8_t *data, uint8_t length) {
+	uint8_t sum = length;
+	remote_putc(REMOTE_SYNC, NULL);
+	remote_putc(length, NULL);
+	for(uint8_t i = 0; i < length; ++i) {
+		sum += data[i];
+		remote_putc(data[i], NULL);
+	}
+	remote_putc(-sum, NULL);
+}
+
+// runs the commands of a binary frame (remoteLine: commands and checksum), the reply is built in place:
+// the reply data is never longer than the commands it answers
+void remote_frame(void) {
+	uint8_t *cmd = remoteLine, *end = remoteLine + remoteFrameLength;
+	uint8_t reply[REMOTE_LINE];
+	uint8_t length = 1, position = 0;
+
+	uint8_t sum = remoteFrameLength;
+	for(uint8_t i = 0; i <= remoteFrameLength; ++i) sum += remoteLine[i];
+	reply[0] = (sum == 0) ? 0 : 0xff;
+
+	while(reply[0] == 0 && cmd < end) {
+		++position;
+		bool ok = false;
+		uint8_t left = end - cmd;
+		struct RemoteField field;
+		switch(*cmd) {
+			case 'S':
+				if(left >= 3 && remote_field(cmd[1], cmd[2], &field) != NULL && left >= 3 + remote_fieldSize(field.type)) {
+					double v;
+					uint16_t u;
+					switch(field.type) {
+						case FieldType_U8:  v = cmd[3];                    break;
+						case FieldType_U16: memcpy(&u, cmd + 3, 2); v = u; break;
+						default:            memcpy(&v, cmd + 3, sizeof(v)); break;
+					}
+					ok = remote_set(cmd[1], cmd[2], v);
+					cmd += 3 + remote_fieldSize(field.type);
+				}
+				break;
+
+			case 'G':
+				if(left >= 3) {
+					uint8_t *p = remote_field(cmd[1], cmd[2], &field);
+					uint8_t size = remote_fieldSize(field.type);
+					if(p != NULL && length + size <= sizeof(reply)) {
+						memcpy(reply + length, p, size);
+						length += size;
+						ok = true;
+					}
+					cmd += 3;
+				}
+				break;
+
+			case 'M':
+				if(left >= 2) {
+					ok = remote_selectMenu(cmd[1]);
+					cmd += 2;
+				}
+				break;
+
+			case 'B':
+				if(left >= 2) {
+					ok = remote_button(cmd[1]);
+					cmd += 2;
+				}
+				break;
+
+			case 'W':
+				if(left >= 2) {
+					ok = arb_save(cmd[1]);
+					cmd += 2;
+				}
+				break;
+
+			case 'L':
+				if(left >= 2) {
+					ok = arb_load(cmd[1]);
+					cmd += 2;
+				}
+				break;
+
+			case 'R':
+				remoteStart = true;
+				ok = true;
+				++cmd;
+				break;
+
+			case 'X':
+				remote_stop();
+				ok = true;
+				++cmd;
+				break;
+
+			case '?':
+				if(length + 2 <= sizeof(reply)) {
+					reply[length++] = running;
+					reply[length++] = config.menuEntry;
+					ok = true;
+				}
+				++cmd;
+				break;
+		}
+		if(!ok) reply[0] = position;
+	}
+	remote_sendFrame(reply, length);
+}
+
+// runs the received commands; called by the main loop and by signal_recheckButtons() while running
+void remote_process(void) {
+	bool executed = false;   // the display is redrawn only after a command
+	while(remoteRxTail != remoteRxHead) {
+		uint8_t c = remoteRx[remoteRxTail];
+		remoteRxTail = (remoteRxTail + 1) & (REMOTE_RX_SIZE - 1);
+
+		switch(remoteState) {
+			case RemoteState_Idle:
+				if(c == REMOTE_SYNC) {
+					remoteState = RemoteState_Length;
+					break;
+				}
+				if(c == REMOTE_ARB_SYNC) {
+					if(running && !arb_isRunning()) remote_stop();
+					arbLoaded    = false;
+					remoteUpload = 0;
+					remoteSum    = 0;
+					remoteState  = RemoteState_Upload;
+					break;
+				}
+				if(c == '\r' || c == '\n') break;
+				remoteState  = RemoteState_Text;
+				remoteLength = 0;
+				// no break, the first character of the line
+
+			case RemoteState_Text:
+				if(c == '\r' || c == '\n') {
+					remoteLine[remoteLength] = 0;
+					remoteState = RemoteState_Idle;
+					remote_text((char *)remoteLine);
+					executed = true;
+				}
+				else if(remoteLength < sizeof(remoteLine) - 1) {
+					remoteLine[remoteLength++] = c;
+				}
+				break;
+
+			case RemoteState_Length:
+				remoteFrameLength = c;
+				remoteLength = 0;
+				remoteState = (c < sizeof(remoteLine)) ? RemoteState_Frame : RemoteState_Idle;
+				break;
+
+			case RemoteState_Frame:
+				remoteLine[remoteLength++] = c;
+				if(remoteLength > remoteFrameLength) {   // the checksum is received
+					remoteState = RemoteState_Idle;
+					remote_frame();
+					executed = true;
+				}
+				break;
+
+			case RemoteState_Upload:
+				remoteSum += c;
+				if(remoteUpload < SIGNAL_BUFFER_SIZE) {
+					signalBuffer[remoteUpload++] = c;
+				}
+				else {   // the checksum
+					uint8_t result = (remoteSum == 0) ? 0 : 0xff;
+					remoteState = RemoteState_Idle;
+					arbLoaded = (result == 0);
+					remote_sendFrame(&result, 1);
+					executed = true;
+				}
+				break;
+		}
+
+		if(remoteStart && remoteState == RemoteState_Idle) {
+			remoteStart = false;
+			menuEntry.updateDisplay();
+			if(!running) buttonHandlers->onStart();   // runs the generator, the next commands are processed inside
+		}
+	}
+	if(executed && !running) menuEntry.updateDisplay();
+}
+#endif
+
 void init(void) {
 	//stderr = &lcd_str;
 	stdout = &lcd_str;
@@ -1939,6 +6265,13 @@ void init(void) {
 	BDDR2  &= ~(_BV(BTN_INT));
 	BPORT2  =  (_BV(BTN_INT));
 
+#if REMOTE
+	remote_init();
+#endif
+#if LIBRARY
+	libraryInit();
+#endif
+
 	setHsDirection();
 	timer2Init();
 	enableMenu();
@@ -1967,6 +6300,9 @@ int main(void) {
 	init();
 	while(1) {
 		processButton();
+#if REMOTE
+		remote_process();
+#endif
 	}
 
 	return 0;
@@ -0,0 +1,491 @@
+//*****************************************************************************
+//
+// File Name	: 'sim_test.c'
+// Title		: Tests of the firmware running in simavr
+// Target		: host, simavr (https://github.com/buserror/simavr)
+//
+// Usage: sim_test <test> <elf>   (make sim-test)
+//   remote    - a REMOTE = 1 build: text commands, a binary frame and an ARB upload played by the ARB mode
+//   counter   - a COUNTER = 1 build: a square wave on T1 and a pulse train on AIN1 measured by the Counter
+//   library   - a LIBRARY = 1 build: a blank flash and an image of wavelib (./wavelib) browsed and played
+//
+// Runs the ATmega32 image at 16 MHz with the buttons released and drives its pins and peripherals
+// through the simavr IRQs the way the hardware would; the LCD on PORTC is decoded as an HD44780
+// in the 4-bit mode, a 25-series flash answers on the SPI with CS on PB4. Prints the failures,
+// returns 0 if all the checks pass.
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sim_avr.h"
+#include "sim_elf.h"
+#include "sim_io.h"
+#include "avr_uart.h"
+#include "avr_ioport.h"
+#include "avr_acomp.h"
+#include "avr_spi.h"
+#include "library.h"
+
+#define CPU_FREQ     16000000
+#define MS           (CPU_FREQ / 1000)
+#define UART_BYTE    1400            // cycles of a byte at 115200 baud (U2X, 117647 baud), a little slower
+
+// the buttons on PORTD, see main.c
+enum { DOWN = 0, LEFT = 1, START = 2, RIGHT = 3, UP = 4, OPT = 6 };
+
+static avr_t *avr;
+static const char *elf;
+static unsigned failures;
+
+#define CHECK(cond, ...) do { if(!(cond)) { ++failures; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while(0)
+
+static uint8_t txQueue[1024];        // to the RXD of the firmware
+static unsigned txHead, txTail;
+static uint64_t txNext;
+static uint8_t rxData[256];          // from the TXD of the firmware
+static unsigned rxCount;
+
+static void uartOutput(struct avr_irq_t *irq, uint32_t value, void *param) {
+	if(rxCount < sizeof(rxData)) rxData[rxCount++] = value;
+}
+
+static bool portACapture;            // the R2R DAC changes are recorded
+static uint8_t portA[4096];
+static unsigned portACount;
+
+static void portAOutput(struct avr_irq_t *irq, uint32_t value, void *param) {
+	if(portACapture && portACount < sizeof(portA)) portA[portACount++] = value;
+}
+
+// HD44780 on PORTC: D4..D7 on PC4..PC7, RS on PC0, E on PC2; the data is taken on the falling edge of E
+static char lcd[0x80];               // DDRAM, line 0 at 0x00, line 1 at 0x40
+static uint8_t lcdAddress, lcdNibble, lcdPort;
+static bool lcdFourBit, lcdLow, lcdCgram;
+
+static void lcdByte(uint8_t c, bool data) {
+	if(data) {
+		if(!lcdCgram) lcd[lcdAddress++ & 0x7F] = c;
+	}
+	else if(c & 0x80) { lcdAddress = c & 0x7F; lcdCgram = false; }
+	else if(c & 0x40) lcdCgram = true;
+	else if(c == 0x01) { memset(lcd, ' ', sizeof(lcd)); lcdAddress = 0; lcdCgram = false; }
+	else if((c & 0xFE) == 0x02) { lcdAddress = 0; lcdCgram = false; }
+}
+
+static void portCOutput(struct avr_irq_t *irq, uint32_t value, void *param) {
+	bool fall = (lcdPort & (1 << 2)) && !(value & (1 << 2));
+	uint8_t previous = lcdPort;
+	lcdPort = value;
+	if(!fall) return;
+	uint8_t nibble = previous >> 4;
+	if(!lcdFourBit) {                // the 8-bit function sets of the init, 0x2 switches to 4 bits
+		if(nibble == 0x2) lcdFourBit = true;
+		return;
+	}
+	if(!lcdLow) {
+		lcdNibble = nibble;
+		lcdLow = true;
+	}
+	else {
+		lcdByte((lcdNibble << 4) | nibble, previous & (1 << 0));
+		lcdLow = false;
+	}
+}
+
+// the 16 characters of the LCD line
+static const char *lcdLine(uint8_t line) {
+	static char text[17];
+	memcpy(text, lcd + (line ? 0x40 : 0x00), 16);
+	text[16] = 0;
+	return text;
+}
+
+// 25-series SPI NOR flash: the read command 0x03 and a 24-bit address, the data follows while CS is low;
+// the bytes outside a read are counted as errors, the erased flash beyond the image reads 0xFF
+static uint8_t *flash;
+static long flashSize;
+static bool flashSelected;
+static unsigned flashByte;           // of the command since CS went low
+static uint32_t flashAddress;
+static unsigned flashReads, flashErrors;
+
+static void flashCs(struct avr_irq_t *irq, uint32_t value, void *param) {
+	flashSelected = !value;
+	flashByte = 0;
+}
+
+static void flashSpi(struct avr_irq_t *irq, uint32_t value, void *param) {
+	uint8_t out = 0xFF;
+	if(!flashSelected) {
+		++flashErrors;
+	}
+	else if(flashByte == 0) {
+		if(value == 0x03) ++flashReads; else ++flashErrors;
+		flashAddress = 0;
+	}
+	else if(flashByte < 4) {
+		flashAddress = (flashAddress << 8) | value;
+	}
+	else {
+		out = (flashAddress < (uint32_t)flashSize) ? flash[flashAddress] : 0xFF;
+		++flashAddress;
+	}
+	++flashByte;
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_INPUT), out);
+}
+
+// runs the firmware for the cycles, feeds the queued bytes to the USART at the line rate;
+// returns false if it crashed
+static bool run(uint64_t cycles) {
+	uint64_t end = avr->cycle + cycles;
+	while(avr->cycle < end) {
+		if(txTail != txHead && avr->cycle >= txNext) {
+			avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_INPUT), txQueue[txTail]);
+			txTail = (txTail + 1) % sizeof(txQueue);
+			txNext = avr->cycle + UART_BYTE;
+		}
+		int state = avr_run(avr);
+		if(state == cpu_Done || state == cpu_Crashed) return false;
+	}
+	return true;
+}
+
+static void send(const void *data, unsigned n) {
+	for(const uint8_t *p = data; n != 0; --n, ++p) {
+		txQueue[txHead] = *p;
+		txHead = (txHead + 1) % sizeof(txQueue);
+	}
+}
+
+// runs until n bytes are received or the time is over, returns the bytes received
+static unsigned receive(unsigned n, unsigned ms) {
+	uint64_t end = avr->cycle + (uint64_t)ms * MS;
+	while(rxCount < n && avr->cycle < end && run(MS / 10)) {}
+	return rxCount;
+}
+
+// sends the text command and returns the reply line (without CR LF), "" on timeout
+static const char *command(const char *line) {
+	static char reply[sizeof(rxData) + 1];
+	rxCount = 0;
+	send(line, strlen(line));
+	send("\r", 1);
+	uint64_t end = avr->cycle + 100ull * MS;
+	while((rxCount == 0 || rxData[rxCount - 1] != '\n') && avr->cycle < end && run(MS / 10)) {}
+	unsigned n = rxCount;
+	while(n != 0 && (rxData[n - 1] == '\r' || rxData[n - 1] == '\n')) --n;
+	memcpy(reply, rxData, n);
+	reply[n] = 0;
+	return reply;
+}
+
+// holds the button (PORTD pin, active low, also pulls the button interrupt INT2) and releases it
+static void press(uint8_t button) {
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), button), 0);
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), 0);
+	run(150 * MS);
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), button), 1);
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), 1);
+	run(150 * MS);
+}
+
+// (re)starts the firmware with a blank EEPROM and the current flash
+static bool load(void) {
+	elf_firmware_t firmware;
+	memset(&firmware, 0, sizeof(firmware));
+	if(elf_read_firmware(elf, &firmware) != 0) {
+		printf("%s: not read\n", elf);
+		return false;
+	}
+	avr = avr_make_mcu_by_name("atmega32");
+	if(avr == NULL) return false;
+	avr_init(avr);
+	avr->frequency = CPU_FREQ;
+	avr_load_firmware(avr, &firmware);
+
+	// the output goes to the test, not to the console
+	uint32_t flags = 0;
+	avr_ioctl(avr, AVR_IOCTL_UART_GET_FLAGS('0'), &flags);
+	flags &= ~AVR_UART_FLAG_STDIO;
+	avr_ioctl(avr, AVR_IOCTL_UART_SET_FLAGS('0'), &flags);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_UART_GETIRQ('0'), UART_IRQ_OUTPUT), uartOutput, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('A'), IOPORT_IRQ_PIN_ALL), portAOutput, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('C'), IOPORT_IRQ_PIN_ALL), portCOutput, NULL);
+	memset(lcd, ' ', sizeof(lcd));
+	lcdFourBit = lcdLow = lcdCgram = false;
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 4), flashCs, NULL);
+	avr_irq_register_notify(avr_io_getirq(avr, AVR_IOCTL_SPI_GETIRQ(0), SPI_IRQ_OUTPUT), flashSpi, NULL);
+	flashSelected = false;
+
+	// the buttons are released (active low), so is the button interrupt INT2
+	static const uint8_t BUTTONS[] = { DOWN, LEFT, START, RIGHT, UP, OPT };
+	for(unsigned i = 0; i < sizeof(BUTTONS); ++i)
+		avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('D'), BUTTONS[i]), 1);
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 2), 1);
+
+	// the LCD init and the settings
+	return run(200 * MS);
+}
+
+// the remote protocol of main.c; field and menu numbers of a REMOTE only build
+static void remoteTest(void) {
+	enum { FIELD_HSFREQ = 4 };   // ARB is the menu entry 8
+
+	// text commands
+	const char *reply = command("freq=100");
+	CHECK(strcmp(reply, "OK") == 0, "freq=100: \"%s\"", reply);
+	reply = command("freq?");
+	CHECK(strncmp(reply, "freq=100.", 9) == 0, "freq?: \"%s\"", reply);
+	CHECK(strcmp(command("menu=2"), "OK") == 0, "menu=2 refused");
+	reply = command("menu?");
+	CHECK(strcmp(reply, "menu=2") == 0, "menu?: \"%s\"", reply);
+	CHECK(strcmp(command("bogus=1"), "ERR") == 0, "an unknown field is accepted");
+	CHECK(strcmp(command("syncOut=200"), "ERR") == 0, "an out of range value is accepted");
+	reply = command("status");
+	CHECK(strcmp(reply, "running=0 menu=2") == 0, "status: \"%s\"", reply);
+
+	// a binary frame: set hsFreq, get it back, the status
+	static const uint8_t FRAME[] = { 0xA5, 8, 'S', FIELD_HSFREQ, 0, 3, 'G', FIELD_HSFREQ, 0, '?', 0 };
+	uint8_t frame[sizeof(FRAME)];
+	memcpy(frame, FRAME, sizeof(frame));
+	for(unsigned i = 1; i < sizeof(frame) - 1; ++i) frame[sizeof(frame) - 1] -= frame[i];
+	static const uint8_t FRAME_REPLY[] = { 0xA5, 4, 0, 3, 0, 2, (uint8_t)-(4 + 3 + 2) };
+	rxCount = 0;
+	send(frame, sizeof(frame));
+	CHECK(receive(sizeof(FRAME_REPLY), 100) == sizeof(FRAME_REPLY) && memcmp(rxData, FRAME_REPLY, sizeof(FRAME_REPLY)) == 0,
+		"frame reply: %u bytes, result %u", rxCount, rxCount > 2 ? rxData[2] : 0);
+
+	// a bad checksum is refused
+	static const uint8_t BAD_FRAME[] = { 0xA5, 1, '?', 0 };
+	static const uint8_t BAD_REPLY[] = { 0xA5, 1, 0xff, 0 };
+	rxCount = 0;
+	send(BAD_FRAME, sizeof(BAD_FRAME));
+	CHECK(receive(sizeof(BAD_REPLY), 100) == sizeof(BAD_REPLY) && memcmp(rxData, BAD_REPLY, sizeof(BAD_REPLY)) == 0,
+		"a bad checksum is accepted");
+
+	// an ARB upload: a permutation of the sample values, so the position of each output sample is known
+	uint8_t upload[1 + 256 + 1], index[256];
+	upload[0] = 0xA6;
+	upload[257] = 0;
+	for(unsigned i = 0; i < 256; ++i) {
+		upload[1 + i] = i * 37 + 11;
+		index[upload[1 + i]] = i;
+		upload[257] -= upload[1 + i];
+	}
+	static const uint8_t UPLOAD_REPLY[] = { 0xA5, 1, 0, 0xff };
+	rxCount = 0;
+	send(upload, sizeof(upload));
+	CHECK(receive(sizeof(UPLOAD_REPLY), 100) == sizeof(UPLOAD_REPLY) && memcmp(rxData, UPLOAD_REPLY, sizeof(UPLOAD_REPLY)) == 0,
+		"upload reply: %u bytes, result %u", rxCount, rxCount > 2 ? rxData[2] : 0);
+
+	// played by the ARB mode at 100 Hz: the output steps through the samples in order
+	CHECK(strcmp(command("menu=8"), "OK") == 0, "menu=8 refused");
+	CHECK(strcmp(command("start"), "OK") == 0, "start refused");
+	portACount = 0;
+	portACapture = true;
+	run(30 * MS);
+	portACapture = false;
+	unsigned steps = 0, wrong = 0;
+	for(unsigned i = 2; i < portACount; ++i) {
+		if(portA[i] == portA[i - 1]) continue;
+		if(index[portA[i]] == (uint8_t)(index[portA[i - 1]] + 1)) ++steps; else ++wrong;
+	}
+	CHECK(steps >= 256 && wrong == 0, "ARB output: %u steps in order, %u out of order", steps, wrong);
+	reply = command("status");
+	CHECK(strcmp(reply, "running=1 menu=8") == 0, "status while running: \"%s\"", reply);
+	CHECK(strcmp(command("stop"), "OK") == 0, "stop refused");
+	run(10 * MS);
+	reply = command("status");
+	CHECK(strcmp(reply, "running=0 menu=8") == 0, "status after stop: \"%s\"", reply);
+}
+
+// stimulus of the counter inputs: a 10 kHz square wave on T1 (PB1), 1 kHz pulses of 250 us on AIN1 (PB3)
+#define T1_HALF_PERIOD   800         // cycles
+#define AIN1_PERIOD      16000
+#define AIN1_WIDTH       4000
+
+static avr_cycle_count_t t1Toggle(struct avr_t *avr, avr_cycle_count_t when, void *param) {
+	static bool high;
+	high = !high;
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_IOPORT_GETIRQ('B'), 1), high);
+	return when + T1_HALF_PERIOD;
+}
+
+static avr_cycle_count_t ain1Pulse(struct avr_t *avr, avr_cycle_count_t when, void *param) {
+	static bool high;
+	high = !high;
+	avr_raise_irq(avr_io_getirq(avr, AVR_IOCTL_ACOMP_GETIRQ, ACOMP_IRQ_AIN1), high ? 3000 : 0);   // mV
+	return when + (high ? AIN1_WIDTH : AIN1_PERIOD - AIN1_WIDTH);
+}
+
+// the value on the second line of the LCD, e.g. " 10000.000Hz"
+static double counterValue(const char *unit) {
+	const char *line = lcdLine(1);
+	char *end;
+	double value = strtod(line, &end);
+	return (end != line && strncmp(end, unit, strlen(unit)) == 0) ? value : -1.0;
+}
+
+// the Counter of main.c: the last menu entry of a COUNTER only build, the default gate of 1 s, no averaging
+static void counterTest(void) {
+	avr_cycle_timer_register(avr, T1_HALF_PERIOD, t1Toggle, NULL);
+	avr_cycle_timer_register(avr, AIN1_PERIOD, ain1Pulse, NULL);
+
+	press(UP);
+	CHECK(strncmp(lcdLine(0), "Counter", 7) == 0, "not the Counter: \"%s\"", lcdLine(0));
+
+	// the frequency: the T1 edges of the 1 s gate
+	press(START);
+	run(1300 * MS);
+	double value = counterValue("Hz");
+	CHECK(value >= 9999.0 && value <= 10001.0, "frequency: \"%s\", 10000 Hz expected", lcdLine(1));
+	press(START);
+
+	// the period and the pulse width: Timer1 captures the comparator output
+	press(RIGHT);
+	CHECK(strncmp(lcdLine(0) + 8, "Period", 6) == 0, "not the period: \"%s\"", lcdLine(0));
+	press(START);
+	run(50 * MS);
+	value = counterValue("us");
+	CHECK(value >= 999.5 && value <= 1000.5, "period: \"%s\", 1000 us expected", lcdLine(1));
+	press(START);
+
+	press(RIGHT);
+	CHECK(strncmp(lcdLine(0) + 8, "Width", 5) == 0, "not the width: \"%s\"", lcdLine(0));
+	press(START);
+	run(50 * MS);
+	value = counterValue("us");
+	CHECK(value >= 249.5 && value <= 250.5, "width: \"%s\", 250 us expected", lcdLine(1));
+	press(START);
+}
+
+static void writeFile(const char *name, const uint8_t *data, unsigned n) {
+	FILE *f = fopen(name, "wb");
+	if(f == NULL || fwrite(data, 1, n, f) != n) {
+		perror(name);
+		exit(2);
+	}
+	fclose(f);
+}
+
+static bool readFlash(const char *name) {
+	FILE *f = fopen(name, "rb");
+	if(f == NULL) return false;
+	fseek(f, 0, SEEK_END);
+	flashSize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	flash = malloc(flashSize);
+	bool ok = fread(flash, 1, flashSize, f) == (size_t)flashSize;
+	fclose(f);
+	return ok;
+}
+
+// counts the output steps to the next sample of the entry (a permutation of the values) and the others
+static void checkSamples(const uint8_t *samples, const char *what) {
+	uint8_t index[256];
+	for(unsigned i = 0; i < 256; ++i) index[samples[i]] = i;
+	unsigned steps = 0, wrong = 0;
+	for(unsigned i = 2; i < portACount; ++i) {
+		if(portA[i] == portA[i - 1]) continue;
+		if(index[portA[i]] == (uint8_t)(index[portA[i - 1]] + 1)) ++steps; else ++wrong;
+	}
+	CHECK(steps >= 256 && wrong == 0, "%s: %u steps in order, %u out of order", what, steps, wrong);
+}
+
+// the Library of main.c, the last menu entry of a LIBRARY only build; the firmware reads the
+// directory at the start, so it is restarted with the image
+static void libraryTest(void) {
+	enum { SPCR = 0x2D };   // data address of the ATmega32
+
+	press(UP);
+	CHECK(strstr(lcdLine(0), "Library") != NULL, "not the Library: \"%s\"", lcdLine(0));
+	CHECK(strncmp(lcdLine(1), "No library", 10) == 0, "a blank flash: \"%s\"", lcdLine(1));
+
+	// a ramp at 100 Hz and a square wave keeping the frequency
+	uint8_t ramp[LIB_SAMPLES], square[LIB_SAMPLES];
+	for(unsigned i = 0; i < LIB_SAMPLES; ++i) {
+		ramp[i] = i * 7 + 3;
+		square[i] = (i < LIB_SAMPLES / 2) ? 0 : 255;
+	}
+	writeFile("sim_test_ramp.raw", ramp, sizeof(ramp));
+	writeFile("sim_test_square.raw", square, sizeof(square));
+	int status = system("./wavelib sim_test.bin Ramp@100=sim_test_ramp.raw Square=sim_test_square.raw >/dev/null");
+	remove("sim_test_ramp.raw");
+	remove("sim_test_square.raw");
+	if(status != 0 || !readFlash("sim_test.bin")) {
+		CHECK(false, "no image from ./wavelib");
+		return;
+	}
+	remove("sim_test.bin");
+	if(!load()) {
+		CHECK(false, "the firmware does not restart");
+		return;
+	}
+	flashReads = flashErrors = 0;
+
+	press(UP);
+	CHECK(strncmp(lcdLine(1), "Ramp ", 5) == 0, "entry 0: \"%s\"", lcdLine(1));
+	press(RIGHT);
+	CHECK(strncmp(lcdLine(1), "Square ", 7) == 0, "entry 1: \"%s\"", lcdLine(1));
+	press(RIGHT);
+	CHECK(strncmp(lcdLine(1), "Square ", 7) == 0, "beyond the last entry: \"%s\"", lcdLine(1));
+	press(LEFT);
+	CHECK(strncmp(lcdLine(1), "Ramp ", 5) == 0, "back to entry 0: \"%s\"", lcdLine(1));
+
+	// START reads the samples and plays them at the frequency of the entry
+	press(START);
+	portACount = 0;
+	portACapture = true;
+	run(30 * MS);
+	portACapture = false;
+	checkSamples(ramp, "the ramp");
+	CHECK(strncmp(lcdLine(1) + 13, "ON", 2) == 0, "not running: \"%s\"", lcdLine(1));
+
+	// the stop flag is in TWBR: the stop leaves the SPI mode 0 alone, the next start reads the flash again
+	press(START);
+	CHECK(strncmp(lcdLine(1) + 13, "OFF", 3) == 0, "not stopped: \"%s\"", lcdLine(1));
+	CHECK(avr->data[SPCR] == 0x50, "SPCR 0x%02x after the stop, 0x50 expected", avr->data[SPCR]);
+	press(RIGHT);
+	press(START);
+	portACount = 0;
+	portACapture = true;
+	run(30 * MS);
+	portACapture = false;
+	unsigned levels[2] = { 0, 0 };
+	for(unsigned i = 0; i < portACount; ++i) {
+		if(portA[i] == 0) ++levels[0];
+		else if(portA[i] == 255) ++levels[1];
+	}
+	CHECK(portACount > 2 && levels[0] + levels[1] >= portACount - 1, "the square: %u changes, %u low, %u high", portACount, levels[0], levels[1]);
+	press(START);
+
+	CHECK(flashReads > 0 && flashErrors == 0, "flash: %u reads, %u bytes outside a read", flashReads, flashErrors);
+	free(flash);
+}
+
+int main(int argc, char *argv[]) {
+	if(argc != 3) {
+		fprintf(stderr, "usage: sim_test remote|counter|library <elf>\n");
+		return 2;
+	}
+	elf = argv[2];
+	if(!load()) {
+		printf("FAIL %s: the firmware does not start\n", elf);
+		return 1;
+	}
+	if(strcmp(argv[1], "remote") == 0) remoteTest();
+	else if(strcmp(argv[1], "counter") == 0) counterTest();
+	else if(strcmp(argv[1], "library") == 0) libraryTest();
+	else {
+		fprintf(stderr, "sim_test: unknown test %s\n", argv[1]);
+		return 2;
+	}
+	if(failures == 0) printf("%s: all checks passed\n", argv[1]);
+	return failures != 0;
+}
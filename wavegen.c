@@ -0,0 +1,454 @@
+//*****************************************************************************
+//
+// File Name	: 'wavegen.c'
+// Title		: Waveform table generator for the AVR DDS2 signal generator
+// Target		: host (runs at build time, see the Makefile)
+//
+// Usage: wavegen <size> <bits> <harmonics> [<record> ...] > waves.h
+//   size      - samples per table (must match SIGNAL_BUFFER_SIZE of main.c)
+//   bits      - DAC resolution, tables are uint8_t up to 8 bits, uint16_t above
+//   harmonics - highest harmonic of the band-limited tables
+//   record    - a long record for the Record mode, default "ecg vibration":
+//               ecg, vibration     - the generated records (8 ECG beats at 500 Hz, a bearing vibration at 8 kHz)
+//               ecg@<rate>         - the ECG at another sample rate, e.g. ecg@100 takes 710 bytes
+//               <name>@<rate>=<file> - imported: name up to 13 characters ('_' is shown as a space),
+//                                  rate the sample rate in Hz; a .csv file is text, the last number of
+//                                  each line is a sample (other lines are skipped) and the samples are
+//                                  scaled to the full range; any other file is raw unsigned 8-bit samples
+//
+// The uint8_t tables are stored in the smallest of three formats, the first byte is the format
+// (expanded by expandWave() of main.c):
+//   WAVE_RAW     - the samples
+//   WAVE_QUARTER - rotation, sum and size/4 + 1 samples of a quarter period; the first half mirrors
+//                  the quarter, the second half is sum minus the first half; the result is rotated left
+//   WAVE_DELTA   - the first sample and a 4-bit delta for each next one (high nibble first);
+//                  the delta -8 escapes an absolute sample in the next two nibbles
+// The uint16_t tables are always the plain samples.
+// The long records RECORD<n> are raw 8-bit samples played straight from flash, RECORD<n>_NAME is the
+// LCD name and RECORD<n>_RATE the sample rate; RECORD_LIST initializes struct Record of main.c.
+// The tables are static: the ones a build of main.c does not use are left out of the flash.
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+// ECG source data: one heart beat, 256 samples of the 8-bit scale; resampled to the table size
+static const uint8_t ECG_SOURCE[] = {
+	73,74,75,75,74,73,73,73,73,72,71,69,68,67,67,67,
+	68,68,67,65,62,61,59,57,56,55,55,54,54,54,55,55,
+	55,55,55,55,54,53,51,50,49,49,52,61,77,101,132,
+	169,207,238,255,254,234,198,154,109,68,37,17,5,
+	0,1,6,13,20,28,36,45,52,57,61,64,65,66,67,68,68,
+	69,70,71,71,71,71,71,71,71,71,72,72,72,73,73,74,
+	75,75,76,77,78,79,80,81,82,83,84,86,88,91,93,96,
+	98,100,102,104,107,109,112,115,118,121,123,125,
+	126,127,127,127,127,127,126,125,124,121,119,116,
+	113,109,105,102,98,95,92,89,87,84,81,79,77,76,75,
+	74,73,72,70,69,68,67,67,67,68,68,68,69,69,69,69,
+	69,69,69,70,71,72,73,73,74,74,75,75,75,75,75,75,
+	74,74,73,73,73,73,72,72,72,71,71,71,71,71,71,71,
+	70,70,70,69,69,69,69,69,70,70,70,69,68,68,67,67,
+	67,67,66,66,66,65,65,65,65,65,65,65,65,64,64,63,
+	63,64,64,65,65,65,65,65,65,65,64,64,64,64,64,64,
+	64,64,65,65,65,66,67,68,69,71,72,73
+};
+
+static unsigned size;       // samples per table
+static unsigned bits;       // DAC resolution
+static unsigned harmonics;  // highest harmonic of the band-limited tables
+static double   top;        // full scale: 2^bits - 1
+static double  *wave;       // table in the [0..1] scale
+static long    *samples;    // quantized table
+static uint8_t *packed;     // compressed table
+static unsigned records;    // records printed so far
+
+static long quantize(double v, double scale) {
+	long q = lround(v * scale);
+	if(q < 0) q = 0;
+	if(q > scale) q = (long)scale;
+	return q;
+}
+
+enum { WAVE_RAW, WAVE_QUARTER, WAVE_DELTA };
+
+// quarter-wave form of samples[] for one of the 4 rotations, off by at most 1 LSB
+// (the rounding of the half-scale samples); returns the packed length or 0
+static unsigned packQuarter(void) {
+	unsigned half = size / 2, quarter = size / 4;
+	long min = samples[0], max = samples[0];
+	for(unsigned i = 1; i < size; ++i) {
+		if(samples[i] < min) min = samples[i];
+		if(samples[i] > max) max = samples[i];
+	}
+	long sum = min + max;
+
+	// the expanded quarter wave is rotated left by r: samples[j] = expanded[(j + r) % size]
+	for(unsigned r = 0; r < size; r += quarter) {
+		unsigned i;
+		for(i = 0; i < size; ++i) {
+			unsigned k = i % half;
+			long v = samples[((k <= quarter ? k : half - k) + size - r) % size];
+			if(i >= half) v = sum - v;
+			if(labs(v - samples[(i + size - r) % size]) > 1) break;
+		}
+		if(i < size) continue;
+
+		packed[0] = WAVE_QUARTER;
+		packed[1] = r;
+		packed[2] = sum;
+		for(i = 0; i <= quarter; ++i) packed[3 + i] = samples[(i + size - r) % size];
+		return 4 + quarter;
+	}
+	return 0;
+}
+
+static unsigned packDelta(void) {
+	unsigned n = 0;   // nibbles
+	packed[0] = WAVE_DELTA;
+	packed[1] = samples[0];
+	for(unsigned i = 1; i < size; ++i) {
+		long d = samples[i] - samples[i - 1];
+		uint8_t nibbles[3] = { d & 0x0f }, count = 1;
+		if(d < -7 || d > 7) {
+			nibbles[0] = 8;
+			nibbles[1] = samples[i] >> 4;
+			nibbles[2] = samples[i] & 0x0f;
+			count = 3;
+		}
+		for(uint8_t k = 0; k < count; ++k, ++n) {
+			if(n % 2 == 0) packed[2 + n / 2]  = nibbles[k] << 4;
+			else           packed[2 + n / 2] |= nibbles[k];
+		}
+	}
+	return 2 + (n + 1) / 2;
+}
+
+static uint32_t xorshift(void) {
+	static uint32_t seed = 2463534242u;
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return seed;
+}
+
+// uniform in [-1..1]
+static double randomSigned(void) {
+	return xorshift() / 2147483647.5 - 1.0;
+}
+
+// prints r[0..n-1] as the next raw 8-bit PROGMEM record
+static void emitRecordSamples(const char *name, const char *comment, const uint8_t *r, unsigned n, unsigned rate) {
+	printf("// %s, %u samples at %u Hz, %.2f s\n", comment, n, rate, (double)n / rate);
+	printf("#define RECORD%u_RATE %u\n", records, rate);
+	printf("static const char RECORD%u_NAME[] PROGMEM = \"%-13.13s\";\n", records, name);
+	printf("static const uint8_t RECORD%u[] PROGMEM = {", records);
+	for(unsigned i = 0; i < n; ++i) {
+		if(i % 16 == 0) printf("\n\t");
+		printf("0x%02x,", r[i]);
+	}
+	printf("\n};\n\n");
+	++records;
+}
+
+// prints r[0..n-1] scaled to the full range as the next record
+static void emitRecord(const char *name, const char *comment, const double *r, unsigned n, unsigned rate) {
+	double min = r[0], max = r[0];
+	for(unsigned i = 1; i < n; ++i) {
+		if(r[i] < min) min = r[i];
+		if(r[i] > max) max = r[i];
+	}
+	uint8_t *q = malloc(n);
+	for(unsigned i = 0; i < n; ++i)
+		q[i] = (max > min) ? quantize((r[i] - min) / (max - min), 255) : 128;
+	emitRecordSamples(name, comment, q, n, rate);
+	free(q);
+}
+
+// ECG_SOURCE beats with the respiratory variation of the R-R interval (60..75 bpm), of the amplitude,
+// a baseline wander and a little noise; the P-QRS-T part keeps its length, the T-P part is stretched
+static void ecgRecord(unsigned rate) {
+	enum { BEATS = 8, WAVE = 180 };   // WAVE: P-QRS-T samples of ECG_SOURCE at 400 Hz
+	const unsigned n = sizeof(ECG_SOURCE);
+	double *r = malloc(BEATS * 2 * rate * sizeof(*r));
+	unsigned count = 0;
+	for(unsigned beat = 0; beat < BEATS; ++beat) {
+		double rr  = 0.88 + 0.08 * sin(2 * M_PI * beat / 4.5) + 0.02 * randomSigned();   // s
+		double amp = 1.0 + 0.06 * sin(2 * M_PI * beat / 4.5 + 1.0);
+		unsigned length = (unsigned)(rr * rate);
+		for(unsigned i = 0; i < length; ++i, ++count) {
+			double s = i * 400.0 / rate;   // position in ECG_SOURCE
+			if(s > WAVE) s = WAVE + (s - WAVE) * (n - 1 - WAVE) / (rr * 400.0 - WAVE);
+			unsigned k = (unsigned)s;
+			double a = ECG_SOURCE[k], b = ECG_SOURCE[(k + 1 < n) ? k + 1 : k];
+			double v = (a + (b - a) * (s - k) - 70) * amp + 70;   // around the baseline
+			v += 10 * sin(2 * M_PI * 0.3 * count / rate) + 1.5 * randomSigned();
+			r[count] = v;
+		}
+	}
+	emitRecord("ECG 8 beats", "ECG, 8 beats", r, count, rate);
+	free(r);
+}
+
+// bearing vibration: the shaft at 50 Hz and the outer race impacts (87.3 Hz) ringing
+// a 1.2 kHz resonance, modulated by the load zone, in the noise
+static void vibrationRecord(void) {
+	enum { RATE = 8000, COUNT = 2048 };
+	double r[COUNT];
+	for(unsigned i = 0; i < COUNT; ++i) {
+		double t = (double)i / RATE;
+		double impact = fmod(t, 1 / 87.3);
+		double load = 0.6 + 0.4 * cos(2 * M_PI * 50 * (t - impact));
+		r[i] = 0.3 * sin(2 * M_PI * 50 * t)
+		     + load * exp(-impact / 0.002) * sin(2 * M_PI * 1200 * impact)
+		     + 0.05 * randomSigned();
+	}
+	emitRecord("Vibration", "bearing vibration", r, COUNT, RATE);
+}
+
+// the last number of the line, returns 0 if the line does not end with a number
+static int lastNumber(char *line, double *v) {
+	int found = 0;
+	for(char *t = strtok(line, ",; \t\r\n"); t != NULL; t = strtok(NULL, ",; \t\r\n")) {
+		char *end;
+		*v = strtod(t, &end);
+		found = (end != t && *end == 0);
+	}
+	return found;
+}
+
+// <name>@<rate>=<file>: a .csv text or raw unsigned 8-bit samples; returns 0 on an error
+static int fileRecord(const char *arg) {
+	char spec[256];
+	strncpy(spec, arg, sizeof(spec) - 1);
+	spec[sizeof(spec) - 1] = 0;
+
+	char *file = strchr(spec, '=');
+	char *at   = strchr(spec, '@');
+	if(file == NULL || at == NULL || at > file) {
+		fprintf(stderr, "wavegen: %s: ecg, vibration or <name>@<rate>=<file> expected\n", arg);
+		return 0;
+	}
+	*file++ = 0;
+	*at++   = 0;
+	long rate = atol(at);
+	if(strlen(spec) > 13 || strpbrk(spec, "\"\\") != NULL || rate < 1 || rate > 65535) {
+		fprintf(stderr, "wavegen: %s: the name is up to 13 characters, the rate 1..65535 Hz\n", arg);
+		return 0;
+	}
+	for(char *c = spec; *c != 0; ++c)
+		if(*c == '_') *c = ' ';
+
+	FILE *f = fopen(file, "rb");
+	if(f == NULL) {
+		perror(file);
+		return 0;
+	}
+	const char *ext = strrchr(file, '.');
+	int csv = (ext != NULL && strcmp(ext, ".csv") == 0);
+	unsigned n = 0;
+	int ok = 1;
+	if(csv) {
+		double *r = malloc(65536 * sizeof(*r));
+		char line[1024];
+		while(n < 65536 && fgets(line, sizeof(line), f) != NULL)
+			if(lastNumber(line, &r[n])) ++n;
+		if(n >= 2 && n <= 65535) emitRecord(spec, file, r, n, rate);
+		else ok = 0;
+		free(r);
+	}
+	else {
+		uint8_t *r = malloc(65536);
+		n = fread(r, 1, 65536, f);
+		if(n >= 2 && n <= 65535) emitRecordSamples(spec, file, r, n, rate);
+		else ok = 0;
+		free(r);
+	}
+	fclose(f);
+	if(!ok) fprintf(stderr, "wavegen: %s: 2..65535 samples expected\n", file);
+	return ok;
+}
+
+// prints wave[] as a PROGMEM table of the given full scale, in the smallest format
+static void emitScaled(const char *name, const char *comment, double scale) {
+	unsigned i, n;
+	for(i = 0; i < size; ++i) samples[i] = quantize(wave[i], scale);
+
+	if(bits > 8) {
+		printf("// %s\n", comment);
+		printf("static const uint16_t %s[] PROGMEM = {", name);
+		for(i = 0; i < size; ++i) {
+			if(i % 16 == 0) printf("\n\t");
+			printf("0x%04lx,", samples[i]);
+		}
+		printf("\n};\n\n");
+		return;
+	}
+
+	const char *format = "quarter wave";
+	n = (size == 256) ? packQuarter() : 0;   // the rotation and the sum are bytes
+	if(n == 0) {
+		format = "delta";
+		n = packDelta();
+	}
+	if(n > size) {
+		format = "raw";
+		packed[0] = WAVE_RAW;
+		for(i = 0; i < size; ++i) packed[1 + i] = samples[i];
+		n = 1 + size;
+	}
+
+	printf("// %s, %s, %u bytes\n", comment, format, n);
+	printf("static const uint8_t %s[] PROGMEM = {", name);
+	for(i = 0; i < n; ++i) {
+		if(i % 16 == 0) printf("\n\t");
+		printf("0x%02x,", packed[i]);
+	}
+	printf("\n};\n\n");
+}
+
+static void emit(const char *name, const char *comment) {
+	emitScaled(name, comment, top);
+}
+
+// scales wave[] to exactly fill [0..1]
+static void normalize(void) {
+	double min = wave[0], max = wave[0];
+	for(unsigned i = 1; i < size; ++i) {
+		if(wave[i] < min) min = wave[i];
+		if(wave[i] > max) max = wave[i];
+	}
+	for(unsigned i = 0; i < size; ++i)
+		wave[i] = (wave[i] - min) / (max - min);
+}
+
+// Fourier series up to the harmonics limit with the Lanczos sigma factor against the Gibbs ringing;
+// odd - odd harmonics only (square), otherwise all (sawtooth); the series is negated to match
+// SQUARE_WAVE (low first half) and SAWTOOTH_WAVE (rising)
+static void bandLimited(int odd) {
+	for(unsigned i = 0; i < size; ++i) {
+		double x = 2 * M_PI * i / size, sum = 0;
+		for(unsigned h = 1; h <= harmonics; h += odd ? 2 : 1) {
+			double s = (double)h / (harmonics + 1);
+			double sigma = sin(M_PI * s) / (M_PI * s);
+			sum -= sigma * sin(h * x) / h;
+		}
+		wave[i] = sum;
+	}
+	normalize();
+}
+
+int main(int argc, char *argv[]) {
+	if(argc < 4) {
+		fprintf(stderr, "usage: wavegen <size> <bits> <harmonics> [<record> ...]\n");
+		return 1;
+	}
+	size      = atoi(argv[1]);
+	bits      = atoi(argv[2]);
+	harmonics = atoi(argv[3]);
+	if(size < 8 || size % 4 != 0 || bits < 1 || bits > 16 || harmonics < 1) {
+		fprintf(stderr, "wavegen: size must be a multiple of 4, bits 1..16, harmonics >= 1\n");
+		return 1;
+	}
+	top  = (1ul << bits) - 1;
+	wave    = malloc(size * sizeof(*wave));
+	samples = malloc(size * sizeof(*samples));
+	packed  = malloc(2 * size);
+
+	printf("// generated by wavegen %u %u %u, do not edit\n\n", size, bits, harmonics);
+	printf("#define WAVE_SIZE      %u\n", size);
+	printf("#define WAVE_BITS      %u\n", bits);
+	printf("#define WAVE_HARMONICS %u\n\n", harmonics);
+	printf("#define WAVE_RAW       %u\n", WAVE_RAW);
+	printf("#define WAVE_QUARTER   %u\n", WAVE_QUARTER);
+	printf("#define WAVE_DELTA     %u\n\n", WAVE_DELTA);
+
+	unsigned i;
+	for(i = 0; i < size; ++i) wave[i] = 0.5 + 0.5 * sin(2 * M_PI * i / size);
+	emit("SINE_WAVE", "sine");
+	emitScaled("SINE_HALF_WAVE", "sine of the half scale, two of them are summed by the dual tone", (top + 1) / 2 - 1);
+
+	for(i = 0; i < size; ++i) wave[i] = (i < size / 2) ? 0.0 : 1.0;
+	emit("SQUARE_WAVE", "square");
+
+	for(i = 0; i < size; ++i) wave[i] = (double)((i <= size / 2) ? i : size - i) / (size / 2);
+	emit("TRIANGLE_WAVE", "triangle");
+
+	for(i = 0; i < size; ++i) wave[i] = (double)i / (size - 1);
+	emit("SAWTOOTH_WAVE", "sawtooth");
+
+	for(i = 0; i < size; ++i) wave[i] = 1.0 - (double)i / (size - 1);
+	emit("REV_SAWTOOTH_WAVE", "reverse sawtooth");
+
+	bandLimited(1);
+	emit("SQUARE_BL_WAVE", "band-limited square");
+
+	bandLimited(0);
+	emit("SAWTOOTH_BL_WAVE", "band-limited sawtooth");
+
+	unsigned n = sizeof(ECG_SOURCE);
+	for(i = 0; i < size; ++i) {
+		double x = (double)i * n / size;
+		unsigned k = (unsigned)x;
+		double a = ECG_SOURCE[k], b = ECG_SOURCE[(k + 1) % n];
+		wave[i] = (a + (b - a) * (x - k)) / 255;
+	}
+	emit("ECG_WAVE", "ECG");
+
+	// every level exactly once, shuffled by a fixed xorshift sequence
+	for(i = 0; i < size; ++i) wave[i] = (double)i / (size - 1);
+	for(i = size - 1; i > 0; --i) {
+		unsigned j = xorshift() % (i + 1);
+		double t = wave[i]; wave[i] = wave[j]; wave[j] = t;
+	}
+	emit("NOISE_SIGNAL", "noise");
+
+	printf("// quarter of the sine period, %u steps + the peak, signed 16-bit scale\n", size / 4);
+	printf("static const int16_t QUARTER_SINE[] PROGMEM = {");
+	for(i = 0; i <= size / 4; ++i) {
+		if(i % 8 == 0) printf("\n\t");
+		printf("%ld,", lround(32767 * sin(M_PI / 2 * i / (size / 4))));
+	}
+	printf("\n};\n\n");
+
+	// the generated records unless others are given
+	static const char *defaults[] = { "ecg", "vibration" };
+	const char **list = (const char **)argv + 4;
+	int count = argc - 4;
+	if(count == 0) {
+		list  = defaults;
+		count = 2;
+	}
+	for(int k = 0; k < count; ++k) {
+		if(strcmp(list[k], "ecg") == 0) ecgRecord(500);
+		else if(strncmp(list[k], "ecg@", 4) == 0 && strchr(list[k], '=') == NULL) {
+			long rate = atol(list[k] + 4);
+			if(rate < 50 || rate > 65535) {
+				fprintf(stderr, "wavegen: %s: the ECG rate is 50..65535 Hz\n", list[k]);
+				return 1;
+			}
+			ecgRecord(rate);
+		}
+		else if(strcmp(list[k], "vibration") == 0) vibrationRecord();
+		else if(!fileRecord(list[k])) return 1;
+	}
+	printf("#define RECORD_COUNT %u\n", records);
+	printf("#define RECORD_LIST");
+	for(unsigned k = 0; k < records; ++k)
+		printf(" \\\n\t{ RECORD%u_NAME, RECORD%u, sizeof(RECORD%u), RECORD%u_RATE },", k, k, k, k);
+	printf("\n");
+
+	free(packed);
+	free(samples);
+	free(wave);
+	return 0;
+}
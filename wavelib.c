@@ -0,0 +1,127 @@
+//*****************************************************************************
+//
+// File Name	: 'wavelib.c'
+// Title		: Builds the SPI flash waveform library of the AVR DDS2 signal generator (LIBRARY build)
+// Target		: host
+//
+// Usage: wavelib <image.bin> <name>[@<freq>]=<file> ...
+//   name - up to 13 characters shown on the LCD
+//   freq - frequency set when the entry is started, Hz; without it the frequency is kept
+//   file - raw unsigned 8-bit samples of one period, resampled to 256 samples
+//
+// The image is written to the 25-series flash by an external programmer (e.g. flashrom);
+// the format is described in library.h, shared with main.c; `make wavelib-test` reads the images back.
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "library.h"
+
+#define SAMPLES   LIB_SAMPLES
+#define HEADER    LIB_ENTRIES
+#define ENTRY     sizeof(struct LibraryEntry)
+#define NAME      sizeof(((struct LibraryEntry *)0)->name)
+
+static void put16(uint8_t *p, uint16_t v) {
+	p[0] = v;
+	p[1] = v >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+	put16(p, v);
+	put16(p + 2, v >> 16);
+}
+
+// one period of the file resampled to SAMPLES; returns 0 on an error
+static int readSamples(const char *name, uint8_t *out) {
+	FILE *f = fopen(name, "rb");
+	if(f == NULL) {
+		perror(name);
+		return 0;
+	}
+	fseek(f, 0, SEEK_END);
+	long n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	uint8_t *in = malloc(n > 0 ? n : 1);
+	if(n <= 0 || fread(in, 1, n, f) != (size_t)n) {
+		fprintf(stderr, "wavelib: %s: no samples\n", name);
+		fclose(f);
+		free(in);
+		return 0;
+	}
+	fclose(f);
+
+	for(unsigned i = 0; i < SAMPLES; ++i) {
+		double x = (double)i * n / SAMPLES;
+		long k = (long)x;
+		int a = in[k], b = in[(k + 1) % n];   // periodic
+		out[i] = a + (b - a) * (x - k) + 0.5;
+	}
+	free(in);
+	return 1;
+}
+
+int main(int argc, char *argv[]) {
+	if(argc < 3) {
+		fprintf(stderr, "usage: wavelib <image.bin> <name>[@<freq>]=<file> ...\n");
+		return 1;
+	}
+	unsigned count = argc - 2;
+	uint32_t data = (HEADER + count * ENTRY + SAMPLES - 1) / SAMPLES * SAMPLES;   // samples are page aligned
+	uint32_t size = data + count * SAMPLES;
+	uint8_t *image = malloc(size);
+	memset(image, 0xff, size);   // erased flash
+
+	struct LibraryHeader *header = (struct LibraryHeader *)image;
+	memset(header, 0, sizeof(*header));
+	memcpy(header->magic, LIB_MAGIC, sizeof(header->magic));
+	put16((uint8_t *)&header->count, count);
+
+	for(unsigned i = 0; i < count; ++i) {
+		char spec[256];
+		strncpy(spec, argv[2 + i], sizeof(spec) - 1);
+		spec[sizeof(spec) - 1] = 0;
+
+		char *file = strchr(spec, '=');
+		if(file == NULL) {
+			fprintf(stderr, "wavelib: %s: <name>[@<freq>]=<file> expected\n", argv[2 + i]);
+			return 1;
+		}
+		*file++ = 0;
+		float freq = 0;
+		char *at = strchr(spec, '@');
+		if(at != NULL) {
+			*at = 0;
+			freq = atof(at + 1);
+		}
+		if(strlen(spec) > NAME - 1) {
+			fprintf(stderr, "wavelib: %s: the name is longer than %u characters\n", spec, (unsigned)NAME - 1);
+			return 1;
+		}
+
+		struct LibraryEntry *entry = (struct LibraryEntry *)(image + HEADER + i * ENTRY);
+		uint32_t address = data + i * SAMPLES;
+		memset(entry, 0, sizeof(*entry));
+		memcpy(entry->name, spec, strlen(spec));
+		uint32_t bits;
+		memcpy(&bits, &freq, 4);          // IEEE single, the AVR double
+		put32((uint8_t *)&entry->freq, bits);
+		put32((uint8_t *)&entry->address, address);
+		if(!readSamples(file, image + address)) return 1;
+	}
+
+	FILE *f = fopen(argv[1], "wb");
+	if(f == NULL || fwrite(image, 1, size, f) != size) {
+		perror(argv[1]);
+		return 1;
+	}
+	fclose(f);
+	printf("%u entries, %lu bytes\n", count, (unsigned long)size);
+	free(image);
+	return 0;
+}
@@ -0,0 +1,133 @@
+//*****************************************************************************
+//
+// File Name	: 'wavelib_test.c'
+// Title		: Round trip of wavelib images through the library format
+// Target		: host
+//
+// Usage: wavelib_test [<wavelib>]   (make wavelib-test)
+//
+// Builds images by wavelib from generated sample files and checks them against library.h:
+// the header, the entries and the samples at entry.address. The firmware reading an image
+// from the flash is tested by sim_test.c (make sim-test). Prints the failures, returns 0 if
+// all the checks pass.
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include "library.h"
+
+static const char *wavelib = "./wavelib";
+static unsigned failures;
+
+#define CHECK(cond, ...) do { if(!(cond)) { ++failures; printf("FAIL %s:%d: ", __FILE__, __LINE__); printf(__VA_ARGS__); printf("\n"); } } while(0)
+
+static uint8_t *image;
+static long imageSize;
+
+// the bytes of the image at the address; the erased flash beyond it reads 0xFF
+static void imageRead(uint32_t address, void *data, unsigned size) {
+	uint8_t *p = data;
+	while(size-- != 0) *p++ = (address < (uint32_t)imageSize) ? image[address++] : 0xFF;
+}
+
+static void writeFile(const char *name, const uint8_t *data, unsigned n) {
+	FILE *f = fopen(name, "wb");
+	if(f == NULL || fwrite(data, 1, n, f) != n) {
+		perror(name);
+		exit(2);
+	}
+	fclose(f);
+}
+
+static int readImage(const char *name) {
+	free(image);
+	image = NULL;
+	FILE *f = fopen(name, "rb");
+	if(f == NULL) return 0;
+	fseek(f, 0, SEEK_END);
+	imageSize = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	image = malloc(imageSize);
+	int ok = fread(image, 1, imageSize, f) == (size_t)imageSize;
+	fclose(f);
+	return ok;
+}
+
+// runs wavelib with the arguments, returns its exit status
+static int run(const char *args) {
+	char command[512];
+	snprintf(command, sizeof(command), "%s %s >/dev/null 2>&1", wavelib, args);
+	return system(command);
+}
+
+int main(int argc, char *argv[]) {
+	if(argc > 1) wavelib = argv[1];
+
+	// a full period of LIB_SAMPLES samples is kept as it is, a shorter one is resampled
+	uint8_t ramp[LIB_SAMPLES], square[64];
+	for(unsigned i = 0; i < LIB_SAMPLES; ++i) ramp[i] = i * 7 + 3;
+	for(unsigned i = 0; i < sizeof(square); ++i) square[i] = (i < sizeof(square) / 2) ? 0 : 255;
+	writeFile("wavelib_test_ramp.raw", ramp, sizeof(ramp));
+	writeFile("wavelib_test_square.raw", square, sizeof(square));
+
+	// entries with and without the frequency, the longest name
+	CHECK(run("wavelib_test.bin Ramp@1234.5=wavelib_test_ramp.raw Square=wavelib_test_square.raw "
+		"Thirteen_char@250000=wavelib_test_ramp.raw") == 0, "wavelib failed");
+	CHECK(readImage("wavelib_test.bin"), "no image");
+	if(image != NULL) {
+		struct LibraryHeader header;
+		imageRead(0, &header, sizeof(header));
+		CHECK(memcmp(header.magic, LIB_MAGIC, sizeof(header.magic)) == 0, "no \"%s\" magic", LIB_MAGIC);
+		uint16_t count = header.count;
+		CHECK(count == 3, "count %u, 3 expected", count);
+
+		static const char *names[] = { "Ramp", "Square", "Thirteen_char" };
+		static const float freqs[] = { 1234.5f, 0.0f, 250000.0f };
+		uint32_t end = 0;
+		for(uint16_t num = 0; num < count && num < 3; ++num) {
+			struct LibraryEntry entry;
+			imageRead(LIB_ENTRIES + num * sizeof(entry), &entry, sizeof(entry));
+			CHECK(memchr(entry.name, 0, sizeof(entry.name)) != NULL, "entry %u: the name has no zero", num);
+			entry.name[sizeof(entry.name) - 1] = 0;
+			CHECK(strcmp(entry.name, names[num]) == 0, "entry %u: name \"%s\", \"%s\" expected", num, entry.name, names[num]);
+			CHECK(entry.freq == freqs[num], "entry %u: freq %g, %g expected", num, entry.freq, freqs[num]);
+			CHECK(entry.address % LIB_SAMPLES == 0, "entry %u: address 0x%lx is not page aligned", num, (unsigned long)entry.address);
+			CHECK(entry.address >= LIB_ENTRIES + count * sizeof(entry), "entry %u: samples overlap the directory", num);
+			CHECK(entry.address >= end, "entry %u: samples overlap the previous entry", num);
+			CHECK(entry.address + LIB_SAMPLES <= (uint32_t)imageSize, "entry %u: samples beyond the image", num);
+			end = entry.address + LIB_SAMPLES;
+
+			uint8_t samples[LIB_SAMPLES];
+			imageRead(entry.address, samples, LIB_SAMPLES);
+			if(num != 1) {
+				CHECK(memcmp(samples, ramp, LIB_SAMPLES) == 0, "entry %u: samples differ from the file", num);
+			}
+			else {
+				// 4 output samples per input sample, the edges are interpolated
+				CHECK(samples[0] == 0 && samples[100] == 0 && samples[140] == 255 && samples[250] == 255,
+					"entry 1: resampled square %u %u %u %u", samples[0], samples[100], samples[140], samples[250]);
+			}
+		}
+		// the directory ends with the entries, the samples or the erased flash follow
+		struct LibraryEntry entry;
+		imageRead(LIB_ENTRIES + count * sizeof(entry), &entry, sizeof(entry));
+		CHECK(entry.address == 0xFFFFFFFF || entry.address + LIB_SAMPLES > (uint32_t)imageSize,
+			"the directory does not end after %u entries", count);
+	}
+
+	// a name longer than the LCD, a missing file
+	CHECK(run("wavelib_test.bin Fourteen_chars=wavelib_test_ramp.raw") != 0, "a 14 character name is accepted");
+	CHECK(run("wavelib_test.bin Missing=wavelib_test_none.raw") != 0, "a missing file is accepted");
+
+	remove("wavelib_test_ramp.raw");
+	remove("wavelib_test_square.raw");
+	remove("wavelib_test.bin");
+	free(image);
+	if(failures == 0) printf("wavelib: all checks passed\n");
+	return failures != 0;
+}
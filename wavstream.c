@@ -0,0 +1,257 @@
+//*****************************************************************************
+//
+// File Name	: 'wavstream.c'
+// Title		: Streams a WAV file to the AVR DDS2 signal generator (REMOTE build, Stream mode)
+// Target		: host, POSIX serial port
+//
+// Usage: wavstream <port> <file.wav> [rate]
+//   port - serial port of the generator, e.g. /dev/ttyUSB0 (115200 baud, 8N1)
+//   rate - output sample rate, Hz; default the rate of the file, 245..11025
+//
+// The file may be 8-bit or 16-bit PCM with any number of channels; the channels are mixed and
+// the samples are converted to the 8-bit DAC scale and linearly resampled to the output rate.
+// The samples are paced to the rate the generator actually plays (CPU_FREQ / (OCR1A + 1), Timer1 CTC)
+// and 0.1% faster, so that the crystal tolerances of both sides never drain its buffer. The surplus
+// is held back by the generator's XOFF: the writes stop at once, so that only the bytes already
+// written can still arrive, and after its XON the pacing restarts from the samples sent, without
+// a burst to catch up. The statistics of the stream are printed at the end.
+//
+// This code is distributed under the GNU Public License
+//		which can be found at http://www.gnu.org/licenses/gpl.txt
+//
+//*****************************************************************************
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <termios.h>
+
+#define MIN_RATE  245       // MIN_STREAM_RATE of main.c
+#define MAX_RATE  11025     // MAX_STREAM_RATE of main.c
+#define PREFILL   96        // STREAM_PREFILL of main.c, sent ahead of the pacing
+#define CPU_FREQ  16000000UL // CPU_FREQ of main.c, the stream timer clock
+#define LEAD      1.001     // pacing ahead of the playback, the generator's XOFF stops the surplus
+#define CHUNK     32        // at most this many samples in flight after an XOFF
+#define XON       0x11
+#define XOFF      0x13
+
+static uint8_t *samples;    // mixed and converted to the 8-bit scale
+static uint32_t count;
+static unsigned fileRate;
+
+static uint32_t le32(const uint8_t *p) {
+	return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t le16(const uint8_t *p) {
+	return p[0] | (p[1] << 8);
+}
+
+// reads the PCM data of the file into samples[]; returns an error message or NULL
+static const char *readWav(const char *name) {
+	FILE *f = fopen(name, "rb");
+	if(f == NULL) return "cannot open the file";
+
+	uint8_t header[12], chunk[8], fmt[16];
+	unsigned channels = 0, bits = 0;
+	if(fread(header, 1, 12, f) != 12 || memcmp(header, "RIFF", 4) != 0 || memcmp(header + 8, "WAVE", 4) != 0) {
+		fclose(f);
+		return "not a WAV file";
+	}
+
+	while(fread(chunk, 1, 8, f) == 8) {
+		uint32_t size = le32(chunk + 4);
+		if(memcmp(chunk, "fmt ", 4) == 0 && size >= 16) {
+			if(fread(fmt, 1, 16, f) != 16) break;
+			if(le16(fmt) != 1) {
+				fclose(f);
+				return "only PCM is supported";
+			}
+			channels = le16(fmt + 2);
+			fileRate = le32(fmt + 4);
+			bits     = le16(fmt + 14);
+			fseek(f, size - 16 + (size & 1), SEEK_CUR);
+		}
+		else if(memcmp(chunk, "data", 4) == 0 && channels != 0) {
+			if(bits != 8 && bits != 16) {
+				fclose(f);
+				return "only 8-bit and 16-bit samples are supported";
+			}
+			unsigned frame = channels * bits / 8;
+			uint8_t *data = malloc(size);
+			size = fread(data, 1, size, f);
+			count = size / frame;
+			samples = malloc(count ? count : 1);
+			for(uint32_t i = 0; i < count; ++i) {
+				long sum = 0;   // signed 16-bit scale
+				for(unsigned c = 0; c < channels; ++c) {
+					const uint8_t *p = data + i * frame + c * bits / 8;
+					sum += (bits == 8) ? (p[0] - 128) * 256 : (int16_t)le16(p);
+				}
+				samples[i] = (sum / (long)channels + 32768) >> 8;
+			}
+			free(data);
+			fclose(f);
+			return NULL;
+		}
+		else {
+			fseek(f, size + (size & 1), SEEK_CUR);
+		}
+	}
+	fclose(f);
+	return "no PCM data";
+}
+
+static void resample(unsigned rate) {
+	uint32_t n = (uint64_t)count * rate / fileRate;
+	uint8_t *out = malloc(n ? n : 1);
+	for(uint32_t i = 0; i < n; ++i) {
+		double x = (double)i * fileRate / rate;
+		uint32_t k = (uint32_t)x;
+		int a = samples[k], b = samples[(k + 1 < count) ? k + 1 : k];
+		out[i] = a + (b - a) * (x - k) + 0.5;
+	}
+	free(samples);
+	samples = out;
+	count = n;
+}
+
+static int openPort(const char *name) {
+	int fd = open(name, O_RDWR | O_NOCTTY);
+	if(fd < 0) return -1;
+
+	struct termios t;
+	tcgetattr(fd, &t);
+	cfmakeraw(&t);
+	cfsetispeed(&t, B115200);
+	cfsetospeed(&t, B115200);
+	t.c_cflag |= CLOCAL | CREAD;
+	t.c_cc[VMIN]  = 0;
+	t.c_cc[VTIME] = 20;     // reads time out after 2 s
+	tcsetattr(fd, TCSANOW, &t);
+	tcflush(fd, TCIOFLUSH);
+	return fd;
+}
+
+// reads a reply line, returns 0 on the timeout
+static int readLine(int fd, char *line, size_t size) {
+	size_t n = 0;
+	char c;
+	while(read(fd, &c, 1) == 1) {
+		if(c == '\n') {
+			line[n] = 0;
+			return 1;
+		}
+		if(c >= ' ' && n < size - 1) line[n++] = c;   // also skips a late XON
+	}
+	return 0;
+}
+
+static int command(int fd, const char *text) {
+	char line[80];
+	if(write(fd, text, strlen(text)) < 0) return 0;
+	if(!readLine(fd, line, sizeof(line))) {
+		fprintf(stderr, "wavstream: no reply to %s", text);
+		return 0;
+	}
+	if(strcmp(line, "OK") != 0) {
+		fprintf(stderr, "wavstream: %s -> %s\n", text, line);
+		return 0;
+	}
+	return 1;
+}
+
+static double now(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+int main(int argc, char *argv[]) {
+	if(argc < 3 || argc > 4) {
+		fprintf(stderr, "usage: wavstream <port> <file.wav> [rate]\n");
+		return 1;
+	}
+
+	const char *error = readWav(argv[2]);
+	if(error != NULL) {
+		fprintf(stderr, "wavstream: %s: %s\n", argv[2], error);
+		return 1;
+	}
+	unsigned rate = (argc == 4) ? (unsigned)atoi(argv[3]) : fileRate;
+	if(rate > MAX_RATE) rate = MAX_RATE;
+	if(rate < MIN_RATE) {
+		fprintf(stderr, "wavstream: the rate must be %u..%u Hz\n", MIN_RATE, MAX_RATE);
+		return 1;
+	}
+	if(rate != fileRate) resample(rate);
+	if(count == 0) {
+		fprintf(stderr, "wavstream: %s: no samples\n", argv[2]);
+		return 1;
+	}
+
+	int fd = openPort(argv[1]);
+	if(fd < 0) {
+		perror(argv[1]);
+		return 1;
+	}
+
+	char text[40];
+	sprintf(text, "streamRate=%u\r\n", rate);
+	if(!command(fd, text)) return 1;
+	sprintf(text, "stream=%lu\r\n", (unsigned long)count);
+	if(!command(fd, text)) return 1;
+
+	double played = (double)CPU_FREQ / (CPU_FREQ / rate);   // OCR1A + 1 = CPU_FREQ / rate
+	printf("%lu samples at %.2f Hz, %.1f s\n", (unsigned long)count, played, count / played);
+	double start = now();
+	int paused = 0;
+	for(uint32_t sent = 0; sent < count; ) {
+		// keep PREFILL samples ahead of the playback
+		double due = (double)(sent > PREFILL ? sent - PREFILL : 0) / (played * LEAD);
+		double wait = start + due - now();
+		if(paused || wait > 0) {
+			// the generator sends nothing but XON/XOFF while streaming
+			struct pollfd p = { fd, POLLIN, 0 };
+			if(poll(&p, 1, paused ? 2000 : (int)(wait * 1000) + 1) > 0) {
+				uint8_t c;
+				while(read(fd, &c, 1) == 1) {
+					if(c == XOFF) paused = 1;
+					else if(c == XON && paused) {
+						paused = 0;
+						start = now() - due;   // the pacing goes on from here
+					}
+					p.revents = 0;
+					if(poll(&p, 1, 0) <= 0) break;
+				}
+			}
+			else if(paused) {
+				fprintf(stderr, "wavstream: no XON from the generator\n");
+				return 1;
+			}
+			continue;
+		}
+		uint32_t n = (count - sent < CHUNK) ? count - sent : CHUNK;
+		ssize_t w = write(fd, samples + sent, n);
+		if(w < 0) {
+			perror(argv[1]);
+			return 1;
+		}
+		sent += w;
+	}
+	tcdrain(fd);
+
+	char line[80];
+	if(readLine(fd, line, sizeof(line)))
+		printf("%s\n", line);
+	else
+		fprintf(stderr, "wavstream: no statistics\n");
+
+	close(fd);
+	free(samples);
+	return 0;
+}